@@ -0,0 +1,179 @@
+#include "jvsc_components.hpp"
+#include "jvsc_registry.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+// Compares the registry's packed component arrays with the std::vector<JvscGameObject>
+// layout they replaced, at 100k and 1M entities.
+
+namespace {
+
+	using clock_type = std::chrono::steady_clock;
+
+	constexpr int RUNS = 10;
+
+	// same members, in the same order, as the old JvscGameObject
+	struct GameObjectAoS
+	{
+		jvsc::JvscMesh* mesh{};
+		glm::vec3 color{};
+		jvsc::Transform2D transform{};
+		unsigned int id;
+	};
+
+	struct InstanceData
+	{
+		glm::mat2 transform;
+		glm::vec2 offset;
+		glm::vec3 color;
+	};
+
+	template<typename Function>
+	double best_ms(Function&& function)
+	{
+		double best = 1e30;
+		for (int run = 0; run < RUNS; run++)
+		{
+			auto start = clock_type::now();
+			function();
+			best = std::min(best, std::chrono::duration<double, std::milli>(clock_type::now() - start).count());
+		}
+		return best;
+	}
+
+	void report(const char* name, size_t count, double aos_ms, double ecs_ms)
+	{
+		std::printf("  %-22s aos %8.3f ms  ecs %8.3f ms  (%5.2f ns/entity, %.2fx)\n",
+			name, aos_ms, ecs_ms, ecs_ms * 1e6 / count, aos_ms / ecs_ms);
+	}
+
+	void bench(size_t count)
+	{
+		std::printf("entities: %zu\n", count);
+
+		std::mt19937 rng{ 1234 };
+		std::uniform_real_distribution<float> unit{ -1.f, 1.f };
+
+		std::vector<GameObjectAoS> objects(count);
+		jvsc::JvscRegistry registry;
+		for (size_t i = 0; i < count; i++)
+		{
+			jvsc::Transform2D transform{};
+			transform.translation = { unit(rng), unit(rng) };
+			transform.rotation = unit(rng);
+			glm::vec3 color{ unit(rng), unit(rng), unit(rng) };
+
+			objects[i].transform = transform;
+			objects[i].color = color;
+			objects[i].id = static_cast<unsigned int>(i);
+
+			jvsc::Entity entity = registry.create();
+			registry.add<jvsc::Transform2D>(entity, transform);
+			registry.add<jvsc::RenderComponent>(entity, nullptr, color);
+		}
+
+		std::vector<InstanceData> instances(count);
+		volatile float sink = 0.f;
+
+		// transforms only, what a movement system touches
+		double aos_ms = best_ms([&]() {
+			for (auto& obj : objects)
+			{
+				obj.transform.rotation += 0.01f;
+				obj.transform.translation.x += 0.001f;
+			}
+		});
+		double ecs_ms = best_ms([&]() {
+			auto& transforms = registry.pool<jvsc::Transform2D>();
+			jvsc::Transform2D* data = transforms.data();
+			for (size_t i = 0; i < transforms.size(); i++)
+			{
+				data[i].rotation += 0.01f;
+				data[i].translation.x += 0.001f;
+			}
+		});
+		report("update transforms", count, aos_ms, ecs_ms);
+
+		// what SimpleRenderSystem does to fill the instance buffer
+		aos_ms = best_ms([&]() {
+			for (size_t i = 0; i < count; i++)
+			{
+				instances[i].transform = objects[i].transform.mat2();
+				instances[i].offset = objects[i].transform.translation;
+				instances[i].color = objects[i].color;
+			}
+			sink = instances[count / 2].offset.x;
+		});
+		ecs_ms = best_ms([&]() {
+			size_t packed = registry.pack<jvsc::RenderComponent, jvsc::Transform2D>();
+			const jvsc::RenderComponent* renderables = registry.pool<jvsc::RenderComponent>().data();
+			const jvsc::Transform2D* transforms = registry.pool<jvsc::Transform2D>().data();
+			for (size_t i = 0; i < packed; i++)
+			{
+				instances[i].transform = transforms[i].mat2();
+				instances[i].offset = transforms[i].translation;
+				instances[i].color = renderables[i].color;
+			}
+			sink = instances[count / 2].offset.x;
+		});
+		report("gather instances", count, aos_ms, ecs_ms);
+
+		// colors alone, the widest gap between the layouts
+		aos_ms = best_ms([&]() {
+			float sum = 0.f;
+			for (auto& obj : objects)
+				sum += obj.color.r;
+			sink = sum;
+		});
+		ecs_ms = best_ms([&]() {
+			auto& renderables = registry.pool<jvsc::RenderComponent>();
+			float sum = 0.f;
+			for (size_t i = 0; i < renderables.size(); i++)
+				sum += renderables[i].color.r;
+			sink = sum;
+		});
+		report("read colors", count, aos_ms, ecs_ms);
+
+		// shuffle one pool, as adds and removes in different orders would: each() then
+		// goes through the sparse arrays until pack() lines the pools up again
+		auto& shuffled = registry.pool<jvsc::RenderComponent>();
+		for (size_t i = 0; i < shuffled.size(); i++)
+			shuffled.swap_entries(i, rng() % shuffled.size());
+
+		double sparse_ms = best_ms([&]() {
+			float sum = 0.f;
+			registry.each<jvsc::Transform2D, jvsc::RenderComponent>([&sum](jvsc::Entity, jvsc::Transform2D& transform, jvsc::RenderComponent& renderable) {
+				sum += transform.rotation * renderable.color.r;
+			});
+			sink = sum;
+		});
+		double pack_ms = best_ms([&]() {
+			sink = static_cast<float>(registry.pack<jvsc::Transform2D, jvsc::RenderComponent>());
+		});
+		double packed_ms = best_ms([&]() {
+			float sum = 0.f;
+			registry.each<jvsc::Transform2D, jvsc::RenderComponent>([&sum](jvsc::Entity, jvsc::Transform2D& transform, jvsc::RenderComponent& renderable) {
+				sum += transform.rotation * renderable.color.r;
+			});
+			sink = sum;
+		});
+		std::printf("  %-22s unpacked %8.3f ms  packed %8.3f ms  pack() when already packed %8.3f ms\n",
+			"each<Transform, Render>", sparse_ms, packed_ms, pack_ms);
+
+		(void)sink;
+	}
+
+}
+
+int main()
+{
+	bench(100'000);
+	bench(1'000'000);
+	return 0;
+}
@@ -0,0 +1,96 @@
+#include "jvsc_job_system.hpp"
+
+// std
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures per-job scheduling overhead and parallel_for scaling with the number of threads.
+
+namespace {
+
+	using clock_type = std::chrono::steady_clock;
+
+	double elapsed_ms(clock_type::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+	}
+
+	void bench_empty_jobs(jvsc::JvscJobSystem& jobs, uint32_t job_count)
+	{
+		std::atomic<uint32_t> executed{ 0 };
+
+		auto start = clock_type::now();
+		jvsc::JobCounter counter;
+		for (uint32_t i = 0; i < job_count; i++)
+			jobs.run([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		jobs.wait(counter);
+		double ms = elapsed_ms(start);
+
+		std::printf("  empty jobs:      %8u jobs  %8.2f ms  %7.1f ns/job\n", executed.load(), ms, ms * 1e6 / job_count);
+	}
+
+	void bench_dependency_chain(jvsc::JvscJobSystem& jobs, uint32_t chain_length)
+	{
+		std::vector<jvsc::JobCounter> counters(chain_length);
+
+		auto start = clock_type::now();
+		jobs.run([]() {}, &counters[0]);
+		for (uint32_t i = 1; i < chain_length; i++)
+			jobs.run_after(counters[i - 1], []() {}, &counters[i]);
+		jobs.wait(counters[chain_length - 1]);
+		double ms = elapsed_ms(start);
+
+		std::printf("  dependency chain:%8u jobs  %8.2f ms  %7.1f ns/link\n", chain_length, ms, ms * 1e6 / chain_length);
+	}
+
+	double bench_parallel_for(jvsc::JvscJobSystem& jobs, std::vector<float>& data)
+	{
+		auto start = clock_type::now();
+		jobs.parallel_for(0, data.size(), 4096, [&data](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				data[i] = std::sqrt(data[i] * 1.0001f + 1.0f) * std::sin(data[i]);
+		});
+		return elapsed_ms(start);
+	}
+
+}
+
+int main()
+{
+	const uint32_t max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<float> data(1 << 24, 1.0f);
+	double single_thread_ms = 0.0;
+
+	for (uint32_t threads = 1; threads <= max_threads; threads *= 2)
+	{
+		auto& jobs = jvsc::JvscJobSystem::create(threads - 1);
+		std::printf("threads: %u\n", jobs.thread_count());
+		if (jobs.thread_count() != threads)
+			throw std::runtime_error("job system started " + std::to_string(jobs.thread_count()) + " threads, " + std::to_string(threads) + " requested");
+
+		bench_empty_jobs(jobs, 1'000'000);
+		bench_dependency_chain(jobs, 100'000);
+
+		bench_parallel_for(jobs, data);
+		double best_ms = 1e30;
+		for (int run = 0; run < 5; run++)
+			best_ms = std::min(best_ms, bench_parallel_for(jobs, data));
+		if (threads == 1)
+			single_thread_ms = best_ms;
+
+		std::printf("  parallel_for:    %8zu items %8.2f ms  speedup %.2fx\n", data.size(), best_ms, single_thread_ms / best_ms);
+
+		jobs.terminate();
+
+		if (threads < max_threads && threads * 2 > max_threads)
+			threads = max_threads / 2;
+	}
+
+	return 0;
+}
@@ -0,0 +1,460 @@
+#include "jvsc_renderer.hpp"
+#include "jvsc_mesh.hpp"
+#include "jvsc_components.hpp"
+#include "jvsc_registry.hpp"
+#include "jvsc_job_system.hpp"
+#include "jvsc_pipeline_registry.hpp"
+#include "jvsc_profiler.hpp"
+#include "systems/simple_render_system.hpp"
+#include "systems/transform_system.hpp"
+#include "systems/culling_system.hpp"
+#include "systems/indirect_render_system.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Renders synthetic scenes for a fixed number of frames and reports CPU and GPU frame time
+// percentiles, draw calls and GPU memory as JSON, so two builds can be compared run for run.
+// Headless unless --windowed is given. The report goes to a file, the engine logs to stdout.
+//
+//   jvsc_bench [--objects 1000,10000,100000,1000000] [--meshes 16] [--pipelines 1]
+//              [--frames 300] [--warmup 30] [--moving 0.1] [--frames-in-flight 2]
+//              [--mode per-object|instanced|parallel|indirect] [--fence-sync] [--render-pass] [--windowed] [--output jvsc_bench.json]
+
+namespace {
+
+	using clock_type = std::chrono::steady_clock;
+
+	constexpr VkExtent2D HEADLESS_EXTENT = { 1280, 720 };
+
+	enum class BenchMode
+	{
+		PerObject,
+		Instanced,
+		Parallel,
+		Indirect
+	};
+
+	struct BenchConfig
+	{
+		std::vector<size_t> object_counts = { 1000, 10000, 100000, 1000000 };
+		uint32_t mesh_count = 16;
+		// each pipeline is a separate SimpleRenderSystem drawing every n-th object, ignored by indirect
+		uint32_t pipeline_count = 1;
+		uint32_t frames = 300;
+		uint32_t warmup_frames = 30;
+		// fraction of objects rotated every frame
+		float moving = 0.1f;
+		uint32_t frames_in_flight = 2;
+		BenchMode mode = BenchMode::Instanced;
+		bool windowed = false;
+		// track GPU progress with fences even where timeline semaphores are available
+		bool fence_sync = false;
+		// render through a VkRenderPass even where VK_KHR_dynamic_rendering is available
+		bool render_pass = false;
+		std::string output_path = "jvsc_bench.json";
+	};
+
+	struct SceneResult
+	{
+		size_t object_count = 0;
+		double setup_ms = 0.0;
+		std::vector<double> cpu_frame_ms;
+		std::vector<double> gpu_frame_ms;
+		uint64_t draw_calls = 0;
+		uint64_t pipeline_binds = 0;
+		uint64_t allocation_bytes = 0;
+		uint64_t block_bytes = 0;
+		uint64_t depth_bytes = 0;
+		bool depth_lazily_allocated = false;
+		bool timeline_semaphore = false;
+		bool dynamic_rendering = false;
+	};
+
+	const char* mode_name(BenchMode mode)
+	{
+		switch (mode)
+		{
+		case BenchMode::PerObject: return "per-object";
+		case BenchMode::Instanced: return "instanced";
+		case BenchMode::Parallel: return "parallel";
+		case BenchMode::Indirect: return "indirect";
+		}
+		return "unknown";
+	}
+
+	BenchMode parse_mode(const std::string& name)
+	{
+		for (BenchMode mode : { BenchMode::PerObject, BenchMode::Instanced, BenchMode::Parallel, BenchMode::Indirect })
+		{
+			if (name == mode_name(mode))
+				return mode;
+		}
+		throw std::runtime_error("unknown mode: " + name);
+	}
+
+	std::vector<size_t> parse_counts(const std::string& list)
+	{
+		std::vector<size_t> counts;
+		size_t begin = 0;
+		while (begin < list.size())
+		{
+			size_t end = list.find(',', begin);
+			if (end == std::string::npos)
+				end = list.size();
+			counts.push_back(static_cast<size_t>(std::stoull(list.substr(begin, end - begin))));
+			begin = end + 1;
+		}
+		return counts;
+	}
+
+	// regular polygon around the origin as a triangle fan, 3 to 34 sides
+	jvsc::JvscMesh* make_polygon(jvsc::JvscRenderer& renderer, uint32_t sides)
+	{
+		std::vector<jvsc::Vertex> vertices;
+		std::vector<uint32_t> indices;
+
+		vertices.push_back({ { 0.f, 0.f }, { 1.f, 1.f, 1.f } });
+		for (uint32_t i = 0; i < sides; i++)
+		{
+			float angle = 6.2831853f * static_cast<float>(i) / static_cast<float>(sides);
+			vertices.push_back({ { std::cos(angle), std::sin(angle) }, { 1.f, 1.f, 1.f } });
+
+			indices.push_back(0);
+			indices.push_back(1 + i);
+			indices.push_back(1 + (i + 1) % sides);
+		}
+
+		return new jvsc::JvscMesh(renderer, vertices, indices);
+	}
+
+	double percentile(std::vector<double> samples, double fraction)
+	{
+		if (samples.empty())
+			return 0.0;
+		std::sort(samples.begin(), samples.end());
+		size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(samples.size())));
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	}
+
+	void write_stats(FILE* out, const char* name, const std::vector<double>& samples)
+	{
+		double mean = samples.empty() ? 0.0 : std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+		std::fprintf(out, "      \"%s\": { \"samples\": %zu, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+			name, samples.size(), mean, percentile(samples, 0.5), percentile(samples, 0.9), percentile(samples, 0.99), percentile(samples, 1.0));
+	}
+
+	SceneResult run_scene(const BenchConfig& config, size_t object_count, jvsc::JvscWindow* window, std::string& device_name)
+	{
+		SceneResult result{};
+		result.object_count = object_count;
+
+		auto setup_start = clock_type::now();
+
+		jvsc::RendererConfig renderer_config{};
+		renderer_config.max_frames_in_flight = config.frames_in_flight;
+		renderer_config.timeline_semaphores = !config.fence_sync;
+		renderer_config.dynamic_rendering = !config.render_pass;
+		jvsc::JvscRenderer* renderer = window
+			? new jvsc::JvscRenderer(*window, renderer_config)
+			: new jvsc::JvscRenderer(HEADLESS_EXTENT, renderer_config);
+		device_name = renderer->device_name();
+
+		if (config.mode == BenchMode::Indirect && !renderer->supports_indirect_draws())
+			throw std::runtime_error("indirect mode needs multiDrawIndirect and drawIndirectFirstInstance");
+
+		std::mt19937 rng{ 1234 };
+		std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+
+		std::vector<jvsc::JvscMesh*> meshes;
+		for (uint32_t i = 0; i < config.mesh_count; i++)
+			meshes.push_back(make_polygon(*renderer, 3 + i % 32));
+
+		// objects small enough that most of the clip square stays visible at every count
+		jvsc::JvscRegistry registry;
+		std::vector<jvsc::Entity> entities;
+		entities.reserve(object_count);
+		for (size_t i = 0; i < object_count; i++)
+		{
+			jvsc::Entity entity = registry.create();
+			registry.add<jvsc::RenderComponent>(entity, meshes[i % meshes.size()], glm::vec3{ unit(rng), unit(rng), unit(rng) });
+
+			jvsc::Transform2D& transform = registry.add<jvsc::Transform2D>(entity);
+			transform.translation = { unit(rng) * 2.2f - 1.1f, unit(rng) * 2.2f - 1.1f };
+			transform.scale = glm::vec2{ 0.005f + unit(rng) * 0.02f };
+			transform.rotation = unit(rng) * 6.2831853f;
+			entities.push_back(entity);
+		}
+		size_t moving_count = static_cast<size_t>(config.moving * static_cast<float>(object_count));
+
+		jvsc::TransformSystem transform_system{};
+		jvsc::CullingSystem culling_system{};
+
+		std::vector<jvsc::SimpleRenderSystem*> render_systems;
+		jvsc::IndirectRenderSystem* indirect_render_system = nullptr;
+		if (config.mode == BenchMode::Indirect)
+		{
+			indirect_render_system = new jvsc::IndirectRenderSystem(*renderer, renderer->render_pass());
+		}
+		else
+		{
+			jvsc::SimpleRenderSystem::RenderMode render_mode = config.mode == BenchMode::PerObject ? jvsc::SimpleRenderSystem::RenderMode::PerObject
+				: config.mode == BenchMode::Parallel ? jvsc::SimpleRenderSystem::RenderMode::Parallel
+				: jvsc::SimpleRenderSystem::RenderMode::Instanced;
+
+			for (uint32_t i = 0; i < std::max(config.pipeline_count, 1u); i++)
+			{
+				render_systems.push_back(new jvsc::SimpleRenderSystem(*renderer, renderer->render_pass()));
+				render_systems.back()->set_render_mode(render_mode);
+			}
+		}
+		std::vector<std::vector<uint32_t>> pipeline_objects(render_systems.size());
+
+		// pipelines compile on the job system, measured frames must not be skipping draws
+		renderer->pipeline_registry().wait_all();
+
+		result.setup_ms = std::chrono::duration<double, std::milli>(clock_type::now() - setup_start).count();
+
+		jvsc::JvscProfiler& profiler = jvsc::JvscProfiler::get();
+		profiler.clear();
+
+		uint32_t total_frames = config.warmup_frames + config.frames;
+		for (uint32_t frame = 0; frame < total_frames; frame++)
+		{
+			auto frame_start = clock_type::now();
+			uint64_t draw_calls = 0;
+			uint64_t pipeline_binds = 0;
+
+			if (window)
+				glfwPollEvents();
+
+			for (size_t i = 0; i < moving_count; i++)
+				registry.get<jvsc::Transform2D>(entities[i]).rotation += 0.01f;
+
+			transform_system.update(registry);
+
+			VkCommandBuffer cmd = renderer->begin_frame();
+
+			if (indirect_render_system)
+			{
+				indirect_render_system->prepare(cmd, registry);
+				renderer->begin_swapchain_render_pass(cmd);
+				indirect_render_system->render(cmd);
+				draw_calls = indirect_render_system->indirect_draw_count();
+				pipeline_binds = 1;
+			}
+			else
+			{
+				culling_system.update(registry);
+				renderer->begin_swapchain_render_pass(cmd, render_systems[0]->subpass_contents());
+
+				if (render_systems.size() == 1)
+				{
+					render_systems[0]->render_game_objects(cmd, registry, culling_system.visible());
+				}
+				else
+				{
+					for (auto& objects : pipeline_objects)
+						objects.clear();
+					for (uint32_t object : culling_system.visible())
+						pipeline_objects[object % pipeline_objects.size()].push_back(object);
+					for (size_t i = 0; i < render_systems.size(); i++)
+						render_systems[i]->render_game_objects(cmd, registry, pipeline_objects[i]);
+				}
+
+				for (auto* render_system : render_systems)
+				{
+					draw_calls += render_system->draw_stats().draws;
+					pipeline_binds += render_system->draw_stats().pipeline_binds;
+				}
+			}
+
+			renderer->end_swapchain_render_pass(cmd);
+			renderer->end_frame(cmd);
+
+			double frame_ms = std::chrono::duration<double, std::milli>(clock_type::now() - frame_start).count();
+
+			// GPU frames arrive frames_in_flight late, once their slot comes around again
+			profiler.collect();
+			bool measuring = frame >= config.warmup_frames;
+			for (const jvsc::ProfileEvent& event : profiler.events())
+			{
+				if (measuring && event.thread == jvsc::JvscProfiler::GPU_THREAD && std::strcmp(event.name, "gpu frame") == 0)
+					result.gpu_frame_ms.push_back(static_cast<double>(event.duration_ns) / 1e6);
+			}
+			profiler.clear();
+
+			if (measuring)
+			{
+				result.cpu_frame_ms.push_back(frame_ms);
+				result.draw_calls = draw_calls;
+				result.pipeline_binds = pipeline_binds;
+			}
+		}
+
+		vkDeviceWaitIdle(renderer->device());
+
+		VmaTotalStatistics statistics{};
+		vmaCalculateStatistics(renderer->allocator(), &statistics);
+		result.allocation_bytes = statistics.total.statistics.allocationBytes;
+		result.block_bytes = statistics.total.statistics.blockBytes;
+		result.depth_bytes = renderer->depth_memory_bytes();
+		result.depth_lazily_allocated = renderer->depth_lazily_allocated();
+		result.timeline_semaphore = renderer->uses_timeline_semaphore();
+		result.dynamic_rendering = renderer->uses_dynamic_rendering();
+
+		if (indirect_render_system)
+		{
+			indirect_render_system->terminate();
+			delete indirect_render_system;
+		}
+		for (auto* render_system : render_systems)
+		{
+			render_system->terminate();
+			delete render_system;
+		}
+		for (auto* mesh : meshes)
+		{
+			mesh->destroy();
+			delete mesh;
+		}
+
+		renderer->terminate();
+		delete renderer;
+
+		return result;
+	}
+
+	void write_report(FILE* out, const BenchConfig& config, const std::string& device_name, const std::vector<SceneResult>& results)
+	{
+		std::fprintf(out, "{\n");
+		std::fprintf(out, "  \"device\": \"%s\",\n", device_name.c_str());
+		std::fprintf(out, "  \"headless\": %s,\n", config.windowed ? "false" : "true");
+		std::fprintf(out, "  \"mode\": \"%s\",\n", mode_name(config.mode));
+		std::fprintf(out, "  \"meshes\": %u,\n", config.mesh_count);
+		std::fprintf(out, "  \"pipelines\": %u,\n", config.mode == BenchMode::Indirect ? 1u : std::max(config.pipeline_count, 1u));
+		std::fprintf(out, "  \"frames\": %u,\n", config.frames);
+		std::fprintf(out, "  \"frames_in_flight\": %u,\n", config.frames_in_flight);
+		std::fprintf(out, "  \"moving\": %.3f,\n", config.moving);
+		std::fprintf(out, "  \"scenes\": [\n");
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const SceneResult& result = results[i];
+			std::fprintf(out, "    {\n");
+			std::fprintf(out, "      \"objects\": %zu,\n", result.object_count);
+			std::fprintf(out, "      \"setup_ms\": %.3f,\n", result.setup_ms);
+			write_stats(out, "cpu_frame_ms", result.cpu_frame_ms);
+			std::fprintf(out, ",\n");
+			write_stats(out, "gpu_frame_ms", result.gpu_frame_ms);
+			std::fprintf(out, ",\n");
+			std::fprintf(out, "      \"draw_calls\": %llu,\n", static_cast<unsigned long long>(result.draw_calls));
+			std::fprintf(out, "      \"pipeline_binds\": %llu,\n", static_cast<unsigned long long>(result.pipeline_binds));
+			std::fprintf(out, "      \"gpu_allocation_bytes\": %llu,\n", static_cast<unsigned long long>(result.allocation_bytes));
+			std::fprintf(out, "      \"gpu_block_bytes\": %llu,\n", static_cast<unsigned long long>(result.block_bytes));
+			std::fprintf(out, "      \"depth_bytes\": %llu,\n", static_cast<unsigned long long>(result.depth_bytes));
+			std::fprintf(out, "      \"depth_lazily_allocated\": %s,\n", result.depth_lazily_allocated ? "true" : "false");
+			std::fprintf(out, "      \"timeline_semaphore\": %s,\n", result.timeline_semaphore ? "true" : "false");
+			std::fprintf(out, "      \"dynamic_rendering\": %s\n", result.dynamic_rendering ? "true" : "false");
+			std::fprintf(out, "    }%s\n", i + 1 < results.size() ? "," : "");
+		}
+
+		std::fprintf(out, "  ]\n}\n");
+	}
+
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config{};
+
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			bool has_value = i + 1 < argc;
+			if (arg == "--objects" && has_value)
+				config.object_counts = parse_counts(argv[++i]);
+			else if (arg == "--meshes" && has_value)
+				config.mesh_count = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+			else if (arg == "--pipelines" && has_value)
+				config.pipeline_count = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+			else if (arg == "--frames" && has_value)
+				config.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--warmup" && has_value)
+				config.warmup_frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--moving" && has_value)
+				config.moving = std::clamp(std::stof(argv[++i]), 0.f, 1.f);
+			else if (arg == "--frames-in-flight" && has_value)
+				config.frames_in_flight = static_cast<uint32_t>(std::stoul(argv[++i]));
+			else if (arg == "--mode" && has_value)
+				config.mode = parse_mode(argv[++i]);
+			else if (arg == "--windowed")
+				config.windowed = true;
+			else if (arg == "--fence-sync")
+				config.fence_sync = true;
+			else if (arg == "--render-pass")
+				config.render_pass = true;
+			else if (arg == "--output" && has_value)
+				config.output_path = argv[++i];
+			else
+				throw std::runtime_error("unknown argument: " + arg);
+		}
+	}
+	catch (const std::exception& error)
+	{
+		std::fprintf(stderr, "%s\n", error.what());
+		return 2;
+	}
+
+	jvsc::JvscWindow* window = config.windowed ? &jvsc::JvscWindow::create_window(static_cast<int>(HEADLESS_EXTENT.width), static_cast<int>(HEADLESS_EXTENT.height), "jvsc_bench") : nullptr;
+	jvsc::JvscJobSystem::create();
+	jvsc::JvscProfiler::create().set_enabled(true);
+
+	std::string device_name;
+	std::vector<SceneResult> results;
+	int exit_code = 0;
+	try
+	{
+		for (size_t object_count : config.object_counts)
+		{
+			std::fprintf(stderr, "scene: %zu objects, %s\n", object_count, mode_name(config.mode));
+			results.push_back(run_scene(config, object_count, window, device_name));
+		}
+	}
+	catch (const std::exception& error)
+	{
+		std::fprintf(stderr, "bench failed: %s\n", error.what());
+		exit_code = 1;
+	}
+
+	FILE* out = std::fopen(config.output_path.c_str(), "w");
+	if (out)
+	{
+		write_report(out, config, device_name, results);
+		std::fclose(out);
+		std::fprintf(stderr, "wrote %s\n", config.output_path.c_str());
+	}
+	else
+	{
+		std::fprintf(stderr, "failed to open %s\n", config.output_path.c_str());
+		exit_code = 1;
+	}
+
+	jvsc::JvscJobSystem::get().terminate();
+	jvsc::JvscProfiler::get().terminate();
+	if (window)
+		window->terminate();
+
+	return exit_code;
+}
@@ -2,61 +2,167 @@
 
 // lib
 #include "systems/simple_render_system.hpp"
+#include "systems/transform_system.hpp"
+#include "systems/culling_system.hpp"
+#include "systems/indirect_render_system.hpp"
+#include "jvsc_mesh_optimizer.hpp"
+#include "jvsc_job_system.hpp"
+#include "jvsc_profiler.hpp"
 
 // std
+#include <algorithm>
 #include <iostream>
 
 
-FirstApp::FirstApp()
+FirstApp::FirstApp(const jvsc::RendererConfig& config)
 	: m_window{jvsc::JvscWindow::create_window(800, 600, "Hello, Vulkan!")}
+	, m_renderer{ m_window, config }
 {
+	jvsc::JvscJobSystem::create();
+	jvsc::JvscProfiler::create().set_thread_name("main");
 	load_game_objects();
 }
 
 FirstApp::~FirstApp()
 {	
+	// the pipeline registry waits for compiles still running on the job system
 	m_renderer.terminate();
+	jvsc::JvscJobSystem::get().terminate();
+	jvsc::JvscProfiler::get().terminate();
 	m_window.terminate();
 }
 
 void FirstApp::run()
 {
 	jvsc::SimpleRenderSystem simple_render_system{ m_renderer, m_renderer.render_pass() };
+	simple_render_system.set_render_mode(jvsc::SimpleRenderSystem::RenderMode::Instanced);
+	jvsc::TransformSystem transform_system{};
+	jvsc::CullingSystem culling_system{};
+
+	// cull and draw on the GPU where the device allows it, the CPU path stays as the fallback
+	jvsc::IndirectRenderSystem* indirect_render_system = nullptr;
+	if (m_renderer.supports_indirect_draws())
+		indirect_render_system = new jvsc::IndirectRenderSystem(m_renderer, m_renderer.render_pass());
+
+	jvsc::JvscProfiler& profiler = jvsc::JvscProfiler::get();
 
 	while (!m_window.should_close())
 	{
-		glfwPollEvents();
-		VkCommandBuffer cmd = m_renderer.begin_frame();
-		m_renderer.begin_swapchain_render_pass(cmd);
+		{
+			JVSC_PROFILE_SCOPE("frame");
+
+			// paced before polling so the input is as fresh as possible when recording starts
+			m_renderer.pace_frame();
+			glfwPollEvents();
+			toggle_profiling();
+			transform_system.update(m_registry);
+
+			VkCommandBuffer cmd = m_renderer.begin_frame();
 
-		simple_render_system.render_game_objects(cmd, m_game_objects);
+			if (indirect_render_system)
+			{
+				toggle_mesh_colors(*indirect_render_system);
+				indirect_render_system->prepare(cmd, m_registry);
+				m_renderer.begin_swapchain_render_pass(cmd);
+				indirect_render_system->render(cmd);
+			}
+			else
+			{
+				culling_system.update(m_registry);
+				m_renderer.begin_swapchain_render_pass(cmd, simple_render_system.subpass_contents());
+				simple_render_system.render_game_objects(cmd, m_registry, culling_system.visible());
+			}
 
-		vkCmdEndRenderPass(cmd);
-		m_renderer.end_frame(cmd);
+			m_renderer.end_swapchain_render_pass(cmd);
+			m_renderer.end_frame(cmd);
+		}
+
+		// drained every frame so the per-thread rings never fill up
+		if (jvsc::JvscProfiler::enabled())
+			profiler.collect();
 	}
 
 	vkDeviceWaitIdle(m_renderer.device());
 
-	for (auto& obj : m_game_objects)
+	if (profiler.event_count() > 0)
+		profiler.write_chrome_trace(m_trace_path);
+
+	const jvsc::FrameLatency& latency = m_renderer.latency();
+	std::cout << "input to " << (latency.measured_at_present ? "present" : "GPU done") << " latency: " << latency.average_ms << " ms average, "
+		<< latency.max_ms << " ms max over the last " << std::min<uint64_t>(latency.frame_count, jvsc::JvscFramePacer::LATENCY_SAMPLES) << " frames" << '\n';
+
+	if (indirect_render_system)
 	{
-		obj.destroy();
+		std::cout << "last frame: " << indirect_render_system->object_count() << " objects culled on the GPU, " << indirect_render_system->uploaded_count() << " uploaded, "
+			<< indirect_render_system->indirect_draw_count() << " indirect draws" << (indirect_render_system->uses_draw_count() ? "" : " (no draw count)") << '\n';
+
+		indirect_render_system->terminate();
+		delete indirect_render_system;
+	}
+	else
+	{
+		const auto& draw_stats = simple_render_system.draw_stats();
+		std::cout << "last frame: " << culling_system.visible_count() << " of " << culling_system.tested_count() << " tested objects visible, "
+			<< draw_stats.draws << " draws, " << draw_stats.binds() << " binds (" << draw_stats.saved_binds() << " saved by sorting)" << '\n';
 	}
 
+	for (auto* mesh : m_meshes)
+	{
+		mesh->destroy();
+		delete mesh;
+	}
+	m_meshes.clear();
+
 	simple_render_system.terminate();
 }
 
+void FirstApp::enable_profiling(const std::string& trace_path)
+{
+	m_trace_path = trace_path;
+	jvsc::JvscProfiler::get().set_enabled(true);
+}
+
+void FirstApp::toggle_profiling()
+{
+	// F2 starts and stops collection, whatever was collected is written when the app exits
+	bool key_down = glfwGetKey(m_window.handle(), GLFW_KEY_F2) == GLFW_PRESS;
+	if (key_down && !m_profile_key_down)
+	{
+		jvsc::JvscProfiler& profiler = jvsc::JvscProfiler::get();
+		profiler.set_enabled(!jvsc::JvscProfiler::enabled());
+		std::cout << "profiling " << (jvsc::JvscProfiler::enabled() ? "on" : "off") << '\n';
+	}
+	m_profile_key_down = key_down;
+}
+
+void FirstApp::toggle_mesh_colors(jvsc::IndirectRenderSystem& indirect_render_system)
+{
+	// F3 switches the GPU-driven path to coloring objects by mesh
+	bool key_down = glfwGetKey(m_window.handle(), GLFW_KEY_F3) == GLFW_PRESS;
+	if (key_down && !m_mesh_color_key_down)
+	{
+		indirect_render_system.set_color_by_mesh(!indirect_render_system.color_by_mesh());
+		std::cout << "color by mesh " << (indirect_render_system.color_by_mesh() ? "on" : "off") << '\n';
+	}
+	m_mesh_color_key_down = key_down;
+}
+
 void FirstApp::load_game_objects()
 {
-	std::vector<jvsc::Vertex> vertices = {
+	jvsc::MeshData mesh_data{};
+	mesh_data.vertices = {
 		{ { 0.0f,-0.5f }, { 1.0f, 0.0f, 0.0f } },
 		{ { 0.5f, 0.5f }, { 0.0f, 1.0f, 0.0f } },
 		{ {-0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } } 
 	};
-	auto mesh = new jvsc::JvscMesh(m_renderer, vertices);
 
-	auto monkey = jvsc::JvscGameObject::create_game_object();
-	monkey.mesh = mesh;
-	monkey.color = { 0.8f, 0.2f, 0.0f };
-	
-	m_game_objects.push_back(std::move(monkey));
+	auto stats = jvsc::JvscMeshOptimizer::optimize(mesh_data);
+	std::cout << "mesh: " << stats.input_vertex_count << " -> " << stats.output_vertex_count << " vertices, ACMR " << stats.acmr_before << " -> " << stats.acmr_after << '\n';
+
+	auto mesh = new jvsc::JvscMesh(m_renderer, mesh_data.vertices, mesh_data.indices);
+	m_meshes.push_back(mesh);
+
+	jvsc::Entity monkey = m_registry.create();
+	m_registry.add<jvsc::RenderComponent>(monkey, mesh, glm::vec3{ 0.8f, 0.2f, 0.0f });
+	m_registry.add<jvsc::Transform2D>(monkey);
 }
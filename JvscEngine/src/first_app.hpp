@@ -3,23 +3,39 @@
 #include "jvsc_window.hpp"
 #include "jvsc_renderer.hpp"
 #include "jvsc_pipeline.hpp"
-#include "jvsc_game_object.hpp"
+#include "jvsc_mesh.hpp"
+#include "jvsc_components.hpp"
+#include "jvsc_registry.hpp"
+
+namespace jvsc {
+	class IndirectRenderSystem;
+}
 
 class FirstApp
 {
 public:
 
-	FirstApp();
+	FirstApp(const jvsc::RendererConfig& config = {});
 
 	~FirstApp();
 
 	void run();
 
+	// starts collecting right away, run() writes the trace to trace_path when it returns
+	void enable_profiling(const std::string& trace_path);
+
 private:
 
 	void load_game_objects();
+	void toggle_profiling();
+	void toggle_mesh_colors(jvsc::IndirectRenderSystem& indirect_render_system);
 
 	jvsc::JvscWindow& m_window;
-	jvsc::JvscRenderer m_renderer{ m_window };
-	std::vector<jvsc::JvscGameObject> m_game_objects;
+	jvsc::JvscRenderer m_renderer;
+	jvsc::JvscRegistry m_registry;
+	std::vector<jvsc::JvscMesh*> m_meshes;
+
+	std::string m_trace_path = "trace.json";
+	bool m_profile_key_down = false;
+	bool m_mesh_color_key_down = false;
 };
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+// lib
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <limits>
+
+namespace jvsc {
+
+    class JvscMesh;
+
+    struct Transform2D {
+        glm::vec2 translation{};  // (position offset)
+        glm::vec2 scale{ 1.f, 1.f };
+        float rotation{};
+
+        glm::mat2 mat2() const {
+            const float s = glm::sin(rotation);
+            const float c = glm::cos(rotation);
+            glm::mat2 rotMatrix{ {c, s}, {-s, c} };
+
+            glm::mat2 scaleMat{ {scale.x, .0f}, {.0f, scale.y} };
+            return rotMatrix * scaleMat;
+        }
+    };
+
+    // Written by TransformSystem from Transform2D. rotation and scale are the inputs the matrix
+    // was built from, the matrix is only rebuilt when Transform2D no longer matches them.
+    struct WorldTransform2D {
+        glm::mat2 matrix{ 1.f };
+        glm::vec2 offset{};
+        glm::vec2 scale{};
+        float rotation{ std::numeric_limits<float>::quiet_NaN() };  // never equal, the first update always builds the matrix
+    };
+
+    // what SimpleRenderSystem needs besides the transform, the mesh is not owned
+    struct RenderComponent {
+        JvscMesh* mesh{};
+        glm::vec3 color{};
+    };
+
+}
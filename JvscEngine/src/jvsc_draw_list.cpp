@@ -0,0 +1,82 @@
+#include "jvsc_draw_list.hpp"
+
+// std
+#include <algorithm>
+
+namespace jvsc {
+
+	uint64_t JvscDrawList::make_key(uint32_t pipeline, uint32_t pool_block, uint32_t mesh, uint32_t material, float depth)
+	{
+		uint64_t quantized_depth = static_cast<uint64_t>(std::clamp(depth, 0.f, 1.f) * 65535.f);
+
+		return (static_cast<uint64_t>(pipeline & 0xff) << 56)
+			| (static_cast<uint64_t>(pool_block & 0xff) << 48)
+			| (static_cast<uint64_t>(mesh & 0xffff) << 32)
+			| (static_cast<uint64_t>(material & 0xffff) << 16)
+			| quantized_depth;
+	}
+
+	void JvscDrawList::sort()
+	{
+		size_t count = m_items.size();
+		m_last_pass_count = 0;
+
+		if (count < MIN_RADIX_SORT_SIZE)
+		{
+			for (size_t i = 1; i < count; i++)
+			{
+				DrawItem item = m_items[i];
+				size_t j = i;
+				for (; j > 0 && m_items[j - 1].key > item.key; j--)
+					m_items[j] = m_items[j - 1];
+				m_items[j] = item;
+			}
+			return;
+		}
+
+		// all eight histograms in one read of the keys
+		uint32_t histograms[8][256] = {};
+		for (const DrawItem& item : m_items)
+		{
+			uint64_t key = item.key;
+			for (int byte = 0; byte < 8; byte++)
+				histograms[byte][(key >> (byte * 8)) & 0xff]++;
+		}
+
+		m_scratch.resize(count);
+		DrawItem* source = m_items.data();
+		DrawItem* destination = m_scratch.data();
+
+		for (int byte = 0; byte < 8; byte++)
+		{
+			uint32_t* histogram = histograms[byte];
+
+			// every key has the same value in this byte, the pass would not move anything
+			uint8_t first_byte = static_cast<uint8_t>(source[0].key >> (byte * 8));
+			if (histogram[first_byte] == count)
+				continue;
+
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < 256; bucket++)
+			{
+				uint32_t bucket_count = histogram[bucket];
+				histogram[bucket] = offset;
+				offset += bucket_count;
+			}
+
+			// stable scatter, keeps the order of the lower bytes sorted so far
+			for (size_t i = 0; i < count; i++)
+			{
+				uint32_t bucket = static_cast<uint32_t>(source[i].key >> (byte * 8)) & 0xff;
+				destination[histogram[bucket]++] = source[i];
+			}
+
+			std::swap(source, destination);
+			m_last_pass_count++;
+		}
+
+		if (source != m_items.data())
+			m_items.swap(m_scratch);
+	}
+
+}
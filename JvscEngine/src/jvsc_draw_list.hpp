@@ -0,0 +1,62 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace jvsc {
+
+	struct DrawItem
+	{
+		uint64_t key;
+		uint32_t object;
+	};
+
+	// Draws tagged with 64-bit keys, most expensive state in the highest bits, so sorting by key
+	// groups draws that can share binds:
+	//
+	//   63..56 pipeline   55..48 mesh pool block   47..32 mesh   31..16 material   15..0 depth
+	//
+	// sort() is an LSD radix sort on bytes. It skips every byte all keys agree on, so unused
+	// fields cost nothing.
+	class JvscDrawList
+	{
+	public:
+
+		JvscDrawList() = default;
+		~JvscDrawList() = default;
+
+		// depth in [0, 1], draws with smaller depth sort first within the same state
+		static uint64_t make_key(uint32_t pipeline, uint32_t pool_block, uint32_t mesh, uint32_t material, float depth);
+
+		static uint32_t key_pipeline(uint64_t key) { return static_cast<uint32_t>(key >> 56); }
+		static uint32_t key_pool_block(uint64_t key) { return static_cast<uint32_t>(key >> 48) & 0xff; }
+		static uint32_t key_mesh(uint64_t key) { return static_cast<uint32_t>(key >> 32) & 0xffff; }
+		static uint32_t key_material(uint64_t key) { return static_cast<uint32_t>(key >> 16) & 0xffff; }
+
+		void clear() { m_items.clear(); }
+		void reserve(size_t count) { m_items.reserve(count); }
+		void add(uint64_t key, uint32_t object) { m_items.push_back(DrawItem{ key, object }); }
+
+		void sort();
+
+		size_t size() const { return m_items.size(); }
+		bool empty() const { return m_items.empty(); }
+		const DrawItem* data() const { return m_items.data(); }
+		const DrawItem& operator[](size_t index) const { return m_items[index]; }
+
+		// byte passes the last sort() actually ran, out of 8
+		uint32_t last_pass_count() const { return m_last_pass_count; }
+
+	private:
+
+		// below this an insertion sort beats building histograms
+		static constexpr size_t MIN_RADIX_SORT_SIZE = 64;
+
+		std::vector<DrawItem> m_items;
+		std::vector<DrawItem> m_scratch;
+		uint32_t m_last_pass_count = 0;
+	};
+
+}
@@ -0,0 +1,126 @@
+#include "jvsc_draw_list.hpp"
+
+// lib
+#include <gtest/gtest.h>
+
+// std
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace jvsc {
+
+	namespace {
+
+		// JvscDrawList::MIN_RADIX_SORT_SIZE, smaller lists are insertion sorted
+		constexpr size_t RADIX_SORT_CUTOFF = 64;
+
+		std::vector<DrawItem> random_items(size_t count, uint64_t key_mask, uint32_t seed)
+		{
+			std::mt19937_64 rng{ seed };
+			std::vector<DrawItem> items(count);
+			for (size_t i = 0; i < count; i++)
+				items[i] = DrawItem{ rng() & key_mask, static_cast<uint32_t>(i) };
+			return items;
+		}
+
+		// sort() is stable, items with equal keys must stay in the order they were added
+		void expect_sorted_like_std(JvscDrawList& list, const std::vector<DrawItem>& items)
+		{
+			list.clear();
+			for (const DrawItem& item : items)
+				list.add(item.key, item.object);
+			list.sort();
+
+			std::vector<DrawItem> expected = items;
+			std::stable_sort(expected.begin(), expected.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; });
+
+			ASSERT_EQ(list.size(), expected.size());
+			for (size_t i = 0; i < expected.size(); i++)
+			{
+				ASSERT_EQ(list[i].key, expected[i].key) << "at " << i;
+				ASSERT_EQ(list[i].object, expected[i].object) << "at " << i;
+			}
+		}
+
+	}
+
+	TEST(DrawListTest, RadixSortMatchesStdSort)
+	{
+		JvscDrawList list;
+		for (size_t count : { RADIX_SORT_CUTOFF, RADIX_SORT_CUTOFF + 1, size_t{ 1000 }, size_t{ 100000 } })
+		{
+			SCOPED_TRACE(count);
+			expect_sorted_like_std(list, random_items(count, ~0ull, static_cast<uint32_t>(count)));
+			EXPECT_EQ(list.last_pass_count(), 8u);
+		}
+	}
+
+	TEST(DrawListTest, RadixSortKeepsEqualKeysInOrder)
+	{
+		// few distinct keys, spread over two bytes so the second pass has to keep the first one's order
+		JvscDrawList list;
+		expect_sorted_like_std(list, random_items(5000, 0x0300'0000'0000'0300ull, 7));
+		EXPECT_EQ(list.last_pass_count(), 2u);
+	}
+
+	TEST(DrawListTest, InsertionSortBelowCutoff)
+	{
+		JvscDrawList list;
+		for (size_t count : { size_t{ 0 }, size_t{ 1 }, size_t{ 2 }, RADIX_SORT_CUTOFF - 1 })
+		{
+			SCOPED_TRACE(count);
+			expect_sorted_like_std(list, random_items(count, ~0ull, 11));
+			EXPECT_EQ(list.last_pass_count(), 0u);
+		}
+
+		// duplicates too, the insertion sort must be as stable as the radix sort
+		expect_sorted_like_std(list, random_items(RADIX_SORT_CUTOFF - 1, 0x3, 12));
+	}
+
+	TEST(DrawListTest, SkipsBytesAllKeysShare)
+	{
+		JvscDrawList list;
+
+		// only the 16 depth bits differ
+		std::vector<DrawItem> items;
+		std::mt19937 rng{ 3 };
+		std::uniform_real_distribution<float> depth{ 0.f, 1.f };
+		for (uint32_t i = 0; i < 1000; i++)
+			items.push_back(DrawItem{ JvscDrawList::make_key(4, 1, 300, 9, depth(rng)), i });
+		expect_sorted_like_std(list, items);
+		EXPECT_EQ(list.last_pass_count(), 2u);
+
+		// only the pipeline byte differs
+		items.clear();
+		for (uint32_t i = 0; i < 1000; i++)
+			items.push_back(DrawItem{ JvscDrawList::make_key(i % 5, 0, 0, 0, 0.f), i });
+		expect_sorted_like_std(list, items);
+		EXPECT_EQ(list.last_pass_count(), 1u);
+
+		// nothing differs, nothing to do
+		items.assign(1000, DrawItem{ JvscDrawList::make_key(1, 2, 3, 4, 0.5f), 0 });
+		for (uint32_t i = 0; i < 1000; i++)
+			items[i].object = i;
+		expect_sorted_like_std(list, items);
+		EXPECT_EQ(list.last_pass_count(), 0u);
+	}
+
+	TEST(DrawListTest, KeyFieldsRoundTrip)
+	{
+		uint64_t key = JvscDrawList::make_key(0xab, 0x12, 0xbeef, 0x1234, 1.f);
+		EXPECT_EQ(JvscDrawList::key_pipeline(key), 0xabu);
+		EXPECT_EQ(JvscDrawList::key_pool_block(key), 0x12u);
+		EXPECT_EQ(JvscDrawList::key_mesh(key), 0xbeefu);
+		EXPECT_EQ(JvscDrawList::key_material(key), 0x1234u);
+		EXPECT_EQ(key & 0xffff, 0xffffu);
+
+		// out of range depth is clamped instead of spilling into the material
+		EXPECT_EQ(JvscDrawList::key_material(JvscDrawList::make_key(0, 0, 0, 7, 2.f)), 7u);
+		EXPECT_EQ(JvscDrawList::make_key(0, 0, 0, 0, -1.f), 0u);
+
+		// smaller depth first within the same state
+		EXPECT_LT(JvscDrawList::make_key(1, 0, 2, 0, 0.25f), JvscDrawList::make_key(1, 0, 2, 0, 0.75f));
+	}
+
+}
@@ -0,0 +1,90 @@
+#include "jvsc_frame_pacer.hpp"
+
+// lib
+#include "jvsc_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace jvsc {
+
+	JvscFramePacer::JvscFramePacer(float max_fps)
+	{
+		set_max_fps(max_fps);
+	}
+
+	void JvscFramePacer::set_max_fps(float max_fps)
+	{
+		m_max_fps = std::max(max_fps, 0.f);
+		m_frame_interval_ns = m_max_fps > 0.f ? static_cast<uint64_t>(1'000'000'000.0 / m_max_fps) : 0;
+		m_next_frame_ns = 0;
+	}
+
+	void JvscFramePacer::wait_for_next_frame()
+	{
+		if (m_frame_interval_ns == 0)
+			return;
+
+		JVSC_PROFILE_SCOPE("frame limiter");
+
+		uint64_t now = JvscProfiler::now_ns();
+		if (m_next_frame_ns == 0 || now > m_next_frame_ns + m_frame_interval_ns)
+		{
+			m_next_frame_ns = now + m_frame_interval_ns;
+			return;
+		}
+
+		if (m_next_frame_ns > now + SPIN_THRESHOLD_NS)
+			std::this_thread::sleep_for(std::chrono::nanoseconds(m_next_frame_ns - now - SPIN_THRESHOLD_NS));
+		while (JvscProfiler::now_ns() < m_next_frame_ns)
+			std::this_thread::yield();
+
+		m_next_frame_ns += m_frame_interval_ns;
+	}
+
+	void JvscFramePacer::begin_tracking(uint64_t id, uint64_t input_ns)
+	{
+		if (m_tracked.size() >= MAX_TRACKED)
+			m_tracked.pop_front();
+		m_tracked.push_back(TrackedFrame{ id, input_ns });
+	}
+
+	void JvscFramePacer::finish_tracking(uint64_t id, uint64_t end_ns, bool at_present)
+	{
+		while (!m_tracked.empty() && m_tracked.front().id <= id)
+		{
+			const TrackedFrame& frame = m_tracked.front();
+			add_sample(end_ns > frame.input_ns ? end_ns - frame.input_ns : 0, at_present);
+			m_tracked.pop_front();
+		}
+	}
+
+	void JvscFramePacer::drop_tracking()
+	{
+		m_tracked.clear();
+	}
+
+	void JvscFramePacer::add_sample(uint64_t latency_ns, bool at_present)
+	{
+		float latency_ms = static_cast<float>(static_cast<double>(latency_ns) / 1'000'000.0);
+		m_samples[m_latency.frame_count % LATENCY_SAMPLES] = latency_ms;
+		m_sample_count = std::min(m_sample_count + 1, LATENCY_SAMPLES);
+
+		float sum = 0.f;
+		float max = 0.f;
+		for (size_t i = 0; i < m_sample_count; i++)
+		{
+			sum += m_samples[i];
+			max = std::max(max, m_samples[i]);
+		}
+
+		m_latency.last_ms = latency_ms;
+		m_latency.average_ms = sum / static_cast<float>(m_sample_count);
+		m_latency.max_ms = max;
+		m_latency.measured_at_present = at_present;
+		m_latency.frame_count++;
+	}
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+// std
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace jvsc {
+
+	// what RendererConfig asks the swapchain for, FIFO is used when the surface lacks the mode
+	enum class PresentMode
+	{
+		Fifo,			// v-sync, never tears, queues up to the swapchain length of frames
+		FifoRelaxed,	// v-sync, tears instead of waiting a whole refresh when a frame is late
+		Mailbox,		// v-sync, a newer frame replaces the queued one, the GPU never waits
+		Immediate,		// no v-sync, lowest latency, tears
+	};
+
+	// input-to-present latency over the last LATENCY_SAMPLES frames, in milliseconds
+	struct FrameLatency
+	{
+		float last_ms = 0.f;
+		float average_ms = 0.f;
+		float max_ms = 0.f;
+		uint64_t frame_count = 0;
+		// true when the end point is the present reported by VK_KHR_present_wait, false when it is
+		// the frame's fence, which misses the time spent queued in the swapchain
+		bool measured_at_present = false;
+	};
+
+	// CPU side of frame pacing for JvscRenderer: sleeps frames up to the configured rate and keeps
+	// the latency statistics. The renderer feeds it the input time of each frame and the time that
+	// frame was seen presented (or done on the GPU). Render thread only.
+	class JvscFramePacer
+	{
+	public:
+
+		static constexpr size_t LATENCY_SAMPLES = 64;
+
+		// max_fps 0 disables the limiter
+		explicit JvscFramePacer(float max_fps = 0.f);
+
+		void set_max_fps(float max_fps);
+		float max_fps() const { return m_max_fps; }
+
+		// blocks until the next frame may start. Sleeps most of the way and spins the rest, sleep
+		// granularity would otherwise cost a millisecond or more of pacing accuracy. A frame that
+		// starts late moves the schedule instead of letting the next frames catch up in a burst.
+		void wait_for_next_frame();
+
+		// frame identified by id (a present id or a submit counter) was started with input sampled at input_ns
+		void begin_tracking(uint64_t id, uint64_t input_ns);
+		// the tracked frames up to and including id finished at end_ns, each becomes a latency sample
+		void finish_tracking(uint64_t id, uint64_t end_ns, bool at_present);
+		// oldest frame still waiting for its end point, 0 when none
+		uint64_t oldest_tracked() const { return m_tracked.empty() ? 0 : m_tracked.front().id; }
+		// forgets frames whose end point will never be reported (failed presents, a recreated swapchain)
+		void drop_tracking();
+
+		const FrameLatency& latency() const { return m_latency; }
+
+	private:
+
+		// sleeping closer to the deadline than this risks oversleeping it
+		static constexpr uint64_t SPIN_THRESHOLD_NS = 1'000'000;
+		// the oldest tracked frames are dropped past this, a present that is never reported must not grow the list
+		static constexpr size_t MAX_TRACKED = 16;
+
+		struct TrackedFrame
+		{
+			uint64_t id;
+			uint64_t input_ns;
+		};
+
+		void add_sample(uint64_t latency_ns, bool at_present);
+
+		float m_max_fps = 0.f;
+		uint64_t m_frame_interval_ns = 0;
+		uint64_t m_next_frame_ns = 0;
+
+		std::deque<TrackedFrame> m_tracked;
+		std::array<float, LATENCY_SAMPLES> m_samples{};
+		size_t m_sample_count = 0;
+		FrameLatency m_latency{};
+	};
+
+}
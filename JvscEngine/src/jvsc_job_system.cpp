@@ -0,0 +1,354 @@
+#include "jvsc_job_system.hpp"
+
+// std
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace jvsc {
+
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* counter;
+	};
+
+	namespace {
+
+		constexpr uint32_t NOT_A_WORKER = ~0u;
+		constexpr int SPINS_BEFORE_SLEEP = 64;
+
+		thread_local uint32_t t_queue_index = NOT_A_WORKER;
+		thread_local uint32_t t_steal_seed = 0;
+
+	}
+
+	// Chase-Lev deque ("Correct and Efficient Work-Stealing for Weak Memory Models", Le et al. 2013)
+	// with a fixed capacity. A full queue makes push() fail and the job runs inline instead.
+	class JvscJobSystem::WorkStealingQueue
+	{
+	public:
+
+		static constexpr int64_t CAPACITY = 4096;
+
+		bool push(Job* job)
+		{
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			int64_t top = m_top.load(std::memory_order_acquire);
+			if (bottom - top >= CAPACITY)
+				return false;
+
+			m_buffer[bottom & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		Job* pop()
+		{
+			int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_top.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return nullptr;
+			}
+
+			Job* job = m_buffer[bottom & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// last element, race the thieves for it
+				if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					job = nullptr;
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		Job* steal()
+		{
+			int64_t top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+			if (top >= bottom)
+				return nullptr;
+
+			Job* job = m_buffer[top & (CAPACITY - 1)].load(std::memory_order_relaxed);
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				return nullptr;
+			return job;
+		}
+
+	private:
+
+		// top and bottom live on separate cache lines, thieves hammer one and the owner the other
+		alignas(64) std::atomic<int64_t> m_top{ 0 };
+		alignas(64) std::atomic<int64_t> m_bottom{ 0 };
+		alignas(64) std::atomic<Job*> m_buffer[CAPACITY];
+	};
+
+	JvscJobSystem* JvscJobSystem::s_instance = nullptr;
+
+	JvscJobSystem& JvscJobSystem::create(uint32_t worker_count)
+	{
+		if (!JvscJobSystem::s_instance)
+			JvscJobSystem::s_instance = new JvscJobSystem(worker_count);
+		else
+			throw std::runtime_error("only 1 job system per application");
+		return *JvscJobSystem::s_instance;
+	}
+
+	JvscJobSystem& JvscJobSystem::get()
+	{
+		if (!JvscJobSystem::s_instance)
+			throw std::runtime_error("the job system wasn't initialized before get");
+		return *JvscJobSystem::s_instance;
+	}
+
+	JvscJobSystem::JvscJobSystem(uint32_t worker_count)
+	{
+		std::cout << "calling job system constructor" << '\n';
+
+		if (worker_count == AUTO_WORKER_COUNT)
+			worker_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		// queue 0 belongs to the creating thread
+		m_queues.resize(worker_count + 1);
+		for (auto& queue : m_queues)
+			queue = std::make_unique<WorkStealingQueue>();
+
+		t_queue_index = 0;
+
+		m_workers.reserve(worker_count);
+		for (uint32_t i = 1; i <= worker_count; i++)
+			m_workers.emplace_back(&JvscJobSystem::worker_loop, this, i);
+	}
+
+	JvscJobSystem::~JvscJobSystem() = default;
+
+	void JvscJobSystem::terminate()
+	{
+		std::cout << "calling job system destructor" << '\n';
+
+		// left in the queues the jobs would leak and their counters never reach zero, the workers help until none remain
+		uint32_t queue_index = t_queue_index;
+		while (m_unfinished_jobs.load() > 0)
+		{
+			Job* job = find_job(queue_index);
+			if (job)
+				execute(job);
+			else
+				std::this_thread::yield();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_sleep_mutex);
+			m_stopping = true;
+		}
+		m_wake.notify_all();
+
+		for (auto& worker : m_workers)
+			worker.join();
+		m_workers.clear();
+
+		t_queue_index = NOT_A_WORKER;
+
+		delete s_instance;
+		s_instance = nullptr;
+	}
+
+	void JvscJobSystem::run(std::function<void()> function, JobCounter* counter)
+	{
+		if (counter)
+			counter->m_value.fetch_add(1, std::memory_order_relaxed);
+
+		m_unfinished_jobs.fetch_add(1);
+		schedule(new Job{ std::move(function), counter });
+	}
+
+	void JvscJobSystem::run_after(JobCounter& dependency, std::function<void()> function, JobCounter* counter)
+	{
+		if (counter)
+			counter->m_value.fetch_add(1, std::memory_order_relaxed);
+
+		m_unfinished_jobs.fetch_add(1);
+		Job* job = new Job{ std::move(function), counter };
+
+		{
+			// the finishing job drains dependents under the same lock after the counter hits zero
+			std::lock_guard<std::mutex> lock(dependency.m_dependents_mutex);
+			if (dependency.m_value.load() != 0)
+			{
+				dependency.m_dependents.push_back(job);
+				return;
+			}
+		}
+
+		schedule(job);
+	}
+
+	void JvscJobSystem::wait(JobCounter& counter)
+	{
+		uint32_t queue_index = t_queue_index;
+
+		while (!counter.done())
+		{
+			Job* job = find_job(queue_index);
+			if (job)
+				execute(job);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	void JvscJobSystem::parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& function)
+	{
+		if (begin >= end)
+			return;
+
+		// a few chunks per thread keeps everyone busy when chunks take uneven time
+		size_t count = end - begin;
+		size_t chunk_size = std::max<size_t>(std::max<size_t>(grain, 1), count / (static_cast<size_t>(thread_count()) * 4));
+		if (chunk_size >= count)
+		{
+			function(begin, end);
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t chunk_begin = begin; chunk_begin < end; chunk_begin += chunk_size)
+		{
+			size_t chunk_end = std::min(chunk_begin + chunk_size, end);
+			run([&function, chunk_begin, chunk_end]() { function(chunk_begin, chunk_end); }, &counter);
+		}
+
+		wait(counter);
+	}
+
+	void JvscJobSystem::schedule(Job* job)
+	{
+		uint32_t queue_index = t_queue_index;
+
+		// counted before it becomes visible, so a thief can never take it while the count reads zero
+		m_queued_jobs.fetch_add(1);
+
+		if (queue_index < m_queues.size())
+		{
+			if (!m_queues[queue_index]->push(job))
+			{
+				m_queued_jobs.fetch_sub(1);
+				execute(job);
+				return;
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock(m_injection_mutex);
+			m_injection_queue.push_back(job);
+		}
+
+		if (m_sleeping_workers.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_sleep_mutex);
+			m_wake.notify_one();
+		}
+	}
+
+	void JvscJobSystem::execute(Job* job)
+	{
+		job->function();
+
+		JobCounter* counter = job->counter;
+		delete job;
+
+		if (counter)
+		{
+			// a waiter may destroy the counter as soon as done() is true, so the last access is m_finishing
+			std::vector<Job*> dependents;
+			counter->m_finishing.fetch_add(1);
+			if (counter->m_value.fetch_sub(1) == 1)
+			{
+				std::lock_guard<std::mutex> lock(counter->m_dependents_mutex);
+				dependents.swap(counter->m_dependents);
+			}
+			counter->m_finishing.fetch_sub(1);
+
+			for (Job* dependent : dependents)
+				schedule(dependent);
+		}
+
+		// only once the dependents are queued, terminate() must not see zero while they are in flight
+		m_unfinished_jobs.fetch_sub(1);
+	}
+
+	Job* JvscJobSystem::find_job(uint32_t queue_index)
+	{
+		Job* job = nullptr;
+
+		if (queue_index < m_queues.size())
+			job = m_queues[queue_index]->pop();
+
+		if (!job)
+		{
+			std::lock_guard<std::mutex> lock(m_injection_mutex);
+			if (!m_injection_queue.empty())
+			{
+				job = m_injection_queue.back();
+				m_injection_queue.pop_back();
+			}
+		}
+
+		if (!job)
+		{
+			// start at a random victim so thieves spread out
+			uint32_t queue_count = static_cast<uint32_t>(m_queues.size());
+			t_steal_seed = t_steal_seed * 1664525u + 1013904223u;
+			uint32_t start = t_steal_seed % queue_count;
+			for (uint32_t i = 0; i < queue_count && !job; i++)
+			{
+				uint32_t victim = (start + i) % queue_count;
+				if (victim != queue_index)
+					job = m_queues[victim]->steal();
+			}
+		}
+
+		if (job)
+			m_queued_jobs.fetch_sub(1);
+		return job;
+	}
+
+	void JvscJobSystem::worker_loop(uint32_t queue_index)
+	{
+		t_queue_index = queue_index;
+		t_steal_seed = queue_index * 2654435761u;
+
+		int idle_spins = 0;
+		while (!m_stopping.load(std::memory_order_relaxed))
+		{
+			Job* job = find_job(queue_index);
+			if (job)
+			{
+				execute(job);
+				idle_spins = 0;
+				continue;
+			}
+
+			if (++idle_spins < SPINS_BEFORE_SLEEP)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleep_mutex);
+			m_sleeping_workers.fetch_add(1);
+			m_wake.wait(lock, [this]() { return m_queued_jobs.load() > 0 || m_stopping.load(); });
+			m_sleeping_workers.fetch_sub(1);
+			idle_spins = 0;
+		}
+	}
+
+}
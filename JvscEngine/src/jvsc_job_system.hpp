@@ -0,0 +1,104 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jvsc {
+
+	struct Job;
+
+	// Counts outstanding jobs. Jobs scheduled with run_after() start once it reaches zero.
+	class JobCounter
+	{
+	public:
+
+		JobCounter() = default;
+		JobCounter(const JobCounter&) = delete;
+		JobCounter& operator=(const JobCounter&) = delete;
+
+		bool done() const { return m_value.load() == 0 && m_finishing.load() == 0; }
+
+	private:
+
+		friend class JvscJobSystem;
+
+		std::atomic<int32_t> m_value{ 0 };
+		// jobs still touching the counter after their decrement, keeps done() false until they let go
+		std::atomic<int32_t> m_finishing{ 0 };
+		std::mutex m_dependents_mutex;
+		std::vector<Job*> m_dependents;
+	};
+
+	// Work-stealing scheduler: every worker, and the thread that created the system, owns a
+	// Chase-Lev deque. Owners push and pop at the bottom, idle workers steal from the top.
+	// Other threads submit through a shared injection queue. Jobs must not throw.
+	class JvscJobSystem
+	{
+	public:
+
+		// create() picks hardware_concurrency - 1 workers
+		static constexpr uint32_t AUTO_WORKER_COUNT = UINT32_MAX;
+
+		// the creating thread also runs jobs while waiting, with worker_count 0 it is the only one
+		static JvscJobSystem& create(uint32_t worker_count = AUTO_WORKER_COUNT);
+
+		static JvscJobSystem& get();
+
+		// runs every job still queued or waiting on a dependency, then joins the workers
+		void terminate();
+
+		// counter, if any, is incremented now and decremented when the job has run
+		void run(std::function<void()> function, JobCounter* counter = nullptr);
+
+		// runs the job once dependency has reached zero
+		void run_after(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr);
+
+		// executes other jobs until counter reaches zero
+		void wait(JobCounter& counter);
+
+		// calls function(chunk_begin, chunk_end) over [begin, end) in chunks of at least grain, returns when all are done
+		void parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& function);
+
+		// workers plus the creating thread
+		uint32_t thread_count() const { return static_cast<uint32_t>(m_queues.size()); }
+
+	private:
+
+		class WorkStealingQueue;
+
+		JvscJobSystem(uint32_t worker_count);
+		~JvscJobSystem();
+		JvscJobSystem(const JvscJobSystem&) = delete;
+		JvscJobSystem& operator=(const JvscJobSystem&) = delete;
+
+		static JvscJobSystem* s_instance;
+
+		void schedule(Job* job);
+		void execute(Job* job);
+		Job* find_job(uint32_t queue_index);
+		void worker_loop(uint32_t queue_index);
+
+		std::vector<std::unique_ptr<WorkStealingQueue>> m_queues;
+		std::vector<std::thread> m_workers;
+
+		std::mutex m_injection_mutex;
+		std::vector<Job*> m_injection_queue;
+
+		// queued but not yet taken, lets idle workers sleep instead of spinning
+		std::atomic<int32_t> m_queued_jobs{ 0 };
+		// created and not yet finished, including jobs waiting on a dependency
+		std::atomic<int32_t> m_unfinished_jobs{ 0 };
+		std::atomic<int32_t> m_sleeping_workers{ 0 };
+		std::mutex m_sleep_mutex;
+		std::condition_variable m_wake;
+		std::atomic<bool> m_stopping{ false };
+	};
+
+}
@@ -3,48 +3,62 @@
 
 namespace jvsc {
 
-	JvscMesh::JvscMesh(JvscRenderer& renderer, std::vector<Vertex>& vertices)
+	static uint32_t s_next_mesh_id = 0;
+
+	JvscMesh::JvscMesh(JvscRenderer& renderer, const std::vector<Vertex>& vertices)
 		: m_renderer{renderer}
+		, m_id{s_next_mesh_id++}
 	{
-		// create buffer
+		// suballocate from the shared mesh pool
 		m_vertex_count = static_cast<uint32_t>(vertices.size());
 		assert(m_vertex_count >= 3 && "vertex count must be at least 3");
-		VkDeviceSize buffer_size = sizeof(vertices[0]) * m_vertex_count;
-
-		VkBufferCreateInfo buffer_info{};
-		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		buffer_info.size = buffer_size;
-		buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		VmaAllocationCreateInfo alloc_info{};
-		alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
-		alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+		compute_bounds(vertices);
+		m_allocation = m_renderer.mesh_pool().allocate(vertices.data(), m_vertex_count, nullptr, 0);
+	}
 
-		if (vmaCreateBuffer(m_renderer.allocator(), &buffer_info, &alloc_info, &m_vertex_buffer, &m_vertex_buffer_allocation, nullptr) != VK_SUCCESS)
-			throw std::runtime_error("failed to create buffer");
+	JvscMesh::JvscMesh(JvscRenderer& renderer, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		: m_renderer{renderer}
+		, m_id{s_next_mesh_id++}
+	{
+		m_vertex_count = static_cast<uint32_t>(vertices.size());
+		m_index_count = static_cast<uint32_t>(indices.size());
+		assert(m_index_count >= 3 && "index count must be at least 3");
 
-		void* data;
-		vmaMapMemory(m_renderer.allocator(), m_vertex_buffer_allocation, &data);
-			memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-		vmaUnmapMemory(m_renderer.allocator(), m_vertex_buffer_allocation);
+		compute_bounds(vertices);
+		m_allocation = m_renderer.mesh_pool().allocate(vertices.data(), m_vertex_count, indices.data(), m_index_count);
 	}
 
 	void JvscMesh::destroy()
 	{
-		vmaDestroyBuffer(m_renderer.allocator(), m_vertex_buffer, m_vertex_buffer_allocation);
+		m_renderer.mesh_pool().free(m_allocation);
+	}
+
+	void JvscMesh::compute_bounds(const std::vector<Vertex>& vertices)
+	{
+		if (vertices.empty())
+			return;
+
+		m_bounds.min = vertices[0].position;
+		m_bounds.max = vertices[0].position;
+		for (const Vertex& vertex : vertices)
+		{
+			m_bounds.min = glm::min(m_bounds.min, vertex.position);
+			m_bounds.max = glm::max(m_bounds.max, vertex.position);
+		}
 	}
 
 	void JvscMesh::bind(VkCommandBuffer cmd)
 	{
-		VkBuffer buffers[] = { m_vertex_buffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(cmd, 0, 1, buffers, offsets);
+		m_renderer.mesh_pool().bind(cmd, m_allocation.block);
 	}
 
-	void JvscMesh::draw(VkCommandBuffer cmd)
+	void JvscMesh::draw(VkCommandBuffer cmd, uint32_t instance_count, uint32_t first_instance)
 	{
-		vkCmdDraw(cmd, m_vertex_count, 1, 0, 0);
+		if (m_index_count > 0)
+			vkCmdDrawIndexed(cmd, m_index_count, instance_count, m_allocation.first_index, static_cast<int32_t>(m_allocation.first_vertex), first_instance);
+		else
+			vkCmdDraw(cmd, m_vertex_count, instance_count, m_allocation.first_vertex, first_instance);
 	}
 
 	std::vector<VkVertexInputBindingDescription> Vertex::get_binding_descriptions()
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "jvsc_renderer.hpp"
+#include "jvsc_mesh_pool.hpp"
 
 // lib
 #define GLM_FORCE_RADIANS
@@ -21,11 +22,19 @@ namespace jvsc {
 		static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions();
 	};
 
+	// axis aligned, in the mesh's own space
+	struct MeshBounds
+	{
+		glm::vec2 min{ 0.f };
+		glm::vec2 max{ 0.f };
+	};
+
 	class JvscMesh
 	{
 	public:
 
-		JvscMesh(JvscRenderer& renderer, std::vector<Vertex>& vertices);
+		JvscMesh(JvscRenderer& renderer, const std::vector<Vertex>& vertices);
+		JvscMesh(JvscRenderer& renderer, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
 		~JvscMesh() = default;
 		void destroy();
 
@@ -33,16 +42,30 @@ namespace jvsc {
 		JvscMesh& operator=(const JvscMesh&) = delete;
 
 		void bind(VkCommandBuffer cmd);
-		void draw(VkCommandBuffer cmd);
+		void draw(VkCommandBuffer cmd, uint32_t instance_count = 1, uint32_t first_instance = 0);
 
+		// meshes in the same pool block can be drawn without rebinding
+		uint32_t pool_block() const { return m_allocation.block; }
+		const MeshAllocation& allocation() const { return m_allocation; }
+		// 0 for meshes drawn without an index buffer
+		uint32_t index_count() const { return m_index_count; }
+
+		const MeshBounds& bounds() const { return m_bounds; }
+
+		// small, unique per mesh, used in draw sort keys
+		uint32_t id() const { return m_id; }
 
 	private:
 
+		void compute_bounds(const std::vector<Vertex>& vertices);
+
 		JvscRenderer& m_renderer;
 
-		VkBuffer m_vertex_buffer;
-		VmaAllocation m_vertex_buffer_allocation;
+		MeshAllocation m_allocation;
 		uint32_t m_vertex_count;
+		uint32_t m_index_count = 0;
+		MeshBounds m_bounds;
+		uint32_t m_id;
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include "jvsc_mesh_optimizer.hpp"
+
+// std
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace jvsc {
+
+	namespace {
+
+		// Forsyth scoring constants, see "Linear-Speed Vertex Cache Optimisation"
+		constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+		constexpr float CACHE_DECAY_POWER = 1.5f;
+		constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+		constexpr float VALENCE_BOOST_SCALE = 2.0f;
+		constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		float vertex_score(int cache_position, uint32_t remaining_triangles)
+		{
+			if (remaining_triangles == 0)
+				return -1.0f;
+
+			float score = 0.0f;
+			if (cache_position >= 0)
+			{
+				// the last triangle's vertices get a fixed score so it isn't simply repeated
+				if (cache_position < 3)
+					score = LAST_TRIANGLE_SCORE;
+				else
+					score = std::pow(1.0f - (cache_position - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+
+			// favour vertices with few triangles left so they can leave the working set
+			score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining_triangles), -VALENCE_BOOST_POWER);
+			return score;
+		}
+
+		struct VertexHash
+		{
+			size_t operator()(const Vertex& vertex) const
+			{
+				// FNV-1a over the raw bytes, matching the bitwise equality below
+				const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vertex);
+				size_t hash = 14695981039346656037ull;
+				for (size_t i = 0; i < sizeof(Vertex); i++)
+				{
+					hash ^= bytes[i];
+					hash *= 1099511628211ull;
+				}
+				return hash;
+			}
+		};
+
+		struct VertexEqual
+		{
+			bool operator()(const Vertex& a, const Vertex& b) const
+			{
+				return memcmp(&a, &b, sizeof(Vertex)) == 0;
+			}
+		};
+
+	}
+
+	MeshOptimizeStats JvscMeshOptimizer::optimize(MeshData& mesh)
+	{
+		assert(mesh.indices.size() % 3 == 0 && "index count must be a multiple of 3");
+
+		MeshOptimizeStats stats{};
+		stats.input_vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+		stats.triangle_count = static_cast<uint32_t>(mesh.indices.size() / 3);
+
+		// non-indexed input is treated as a triangle soup
+		if (mesh.indices.empty())
+		{
+			std::vector<uint32_t> soup_indices(mesh.vertices.size());
+			for (uint32_t i = 0; i < soup_indices.size(); i++)
+				soup_indices[i] = i;
+			stats.triangle_count = static_cast<uint32_t>(mesh.vertices.size() / 3);
+			stats.acmr_before = compute_acmr(soup_indices, stats.input_vertex_count);
+
+			mesh = deduplicate(mesh.vertices);
+		}
+		else
+		{
+			stats.acmr_before = compute_acmr(mesh.indices, stats.input_vertex_count);
+
+			// expand and re-index so duplicates shared across different indices merge too
+			std::vector<Vertex> expanded(mesh.indices.size());
+			for (size_t i = 0; i < mesh.indices.size(); i++)
+				expanded[i] = mesh.vertices[mesh.indices[i]];
+			mesh = deduplicate(expanded);
+		}
+
+		optimize_vertex_cache(mesh.indices, static_cast<uint32_t>(mesh.vertices.size()));
+		optimize_vertex_fetch(mesh);
+
+		stats.output_vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+		stats.acmr_after = compute_acmr(mesh.indices, stats.output_vertex_count);
+		return stats;
+	}
+
+	MeshData JvscMeshOptimizer::deduplicate(const std::vector<Vertex>& vertices)
+	{
+		MeshData mesh{};
+		mesh.indices.reserve(vertices.size());
+
+		std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique_vertices;
+		unique_vertices.reserve(vertices.size());
+
+		for (const auto& vertex : vertices)
+		{
+			auto [it, inserted] = unique_vertices.try_emplace(vertex, static_cast<uint32_t>(mesh.vertices.size()));
+			if (inserted)
+				mesh.vertices.push_back(vertex);
+			mesh.indices.push_back(it->second);
+		}
+
+		return mesh;
+	}
+
+	void JvscMeshOptimizer::optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count)
+	{
+		const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+		if (triangle_count == 0)
+			return;
+
+		// vertex -> triangle adjacency, each vertex's live triangles are kept at the front of its range
+		std::vector<uint32_t> remaining(vertex_count, 0);
+		for (uint32_t index : indices)
+			remaining[index]++;
+
+		std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+		for (uint32_t v = 0; v < vertex_count; v++)
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining[v];
+
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+		for (uint32_t t = 0; t < triangle_count; t++)
+		{
+			for (uint32_t k = 0; k < 3; k++)
+				adjacency[fill[indices[t * 3 + k]]++] = t;
+		}
+
+		std::vector<int> cache_positions(vertex_count, -1);
+		std::vector<float> vertex_scores(vertex_count);
+		for (uint32_t v = 0; v < vertex_count; v++)
+			vertex_scores[v] = vertex_score(-1, remaining[v]);
+
+		std::vector<bool> emitted(triangle_count, false);
+
+		int best_triangle = -1;
+		float best_score = -1.0f;
+		for (uint32_t t = 0; t < triangle_count; t++)
+		{
+			float score = vertex_scores[indices[t * 3]] + vertex_scores[indices[t * 3 + 1]] + vertex_scores[indices[t * 3 + 2]];
+			if (score > best_score)
+			{
+				best_score = score;
+				best_triangle = static_cast<int>(t);
+			}
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		std::vector<uint32_t> cache;
+		std::vector<uint32_t> next_cache;
+		cache.reserve(FORSYTH_CACHE_SIZE + 3);
+		next_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+		uint32_t input_cursor = 0;
+
+		for (uint32_t emitted_count = 0; emitted_count < triangle_count; emitted_count++)
+		{
+			// nothing in the cache has triangles left, resume from the first triangle not yet emitted
+			if (best_triangle < 0)
+			{
+				while (emitted[input_cursor])
+					input_cursor++;
+				best_triangle = static_cast<int>(input_cursor);
+			}
+
+			const uint32_t t = static_cast<uint32_t>(best_triangle);
+			const uint32_t tri[3] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+
+			output.insert(output.end(), tri, tri + 3);
+			emitted[t] = true;
+
+			for (uint32_t v : tri)
+			{
+				uint32_t begin = adjacency_offsets[v];
+				uint32_t end = begin + remaining[v];
+				for (uint32_t i = begin; i < end; i++)
+				{
+					if (adjacency[i] == t)
+					{
+						adjacency[i] = adjacency[end - 1];
+						remaining[v]--;
+						break;
+					}
+				}
+			}
+
+			// the emitted triangle's vertices move to the front, everything else shifts back
+			next_cache.assign(tri, tri + 3);
+			for (uint32_t v : cache)
+			{
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					next_cache.push_back(v);
+			}
+			cache.swap(next_cache);
+
+			for (uint32_t i = 0; i < cache.size(); i++)
+			{
+				uint32_t v = cache[i];
+				cache_positions[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+				vertex_scores[v] = vertex_score(cache_positions[v], remaining[v]);
+			}
+
+			best_triangle = -1;
+			best_score = -1.0f;
+			for (uint32_t v : cache)
+			{
+				uint32_t begin = adjacency_offsets[v];
+				for (uint32_t i = begin; i < begin + remaining[v]; i++)
+				{
+					uint32_t adjacent = adjacency[i];
+					float score = vertex_scores[indices[adjacent * 3]] + vertex_scores[indices[adjacent * 3 + 1]] + vertex_scores[indices[adjacent * 3 + 2]];
+					if (score > best_score)
+					{
+						best_score = score;
+						best_triangle = static_cast<int>(adjacent);
+					}
+				}
+			}
+
+			// vertices pushed past the end of the cache are evicted for good
+			if (cache.size() > FORSYTH_CACHE_SIZE)
+				cache.resize(FORSYTH_CACHE_SIZE);
+		}
+
+		indices.swap(output);
+	}
+
+	void JvscMeshOptimizer::optimize_vertex_fetch(MeshData& mesh)
+	{
+		constexpr uint32_t unused = ~0u;
+		std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+
+		std::vector<Vertex> vertices;
+		vertices.reserve(mesh.vertices.size());
+
+		for (uint32_t& index : mesh.indices)
+		{
+			if (remap[index] == unused)
+			{
+				remap[index] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(mesh.vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		mesh.vertices.swap(vertices);
+	}
+
+	float JvscMeshOptimizer::compute_acmr(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+	{
+		const size_t triangle_count = indices.size() / 3;
+		if (triangle_count == 0)
+			return 0.0f;
+
+		// a vertex is cached while fewer than cache_size misses happened since it was loaded
+		std::vector<uint32_t> load_time(vertex_count, 0);
+		uint32_t misses = 0;
+
+		for (uint32_t index : indices)
+		{
+			if (load_time[index] == 0 || misses - load_time[index] >= cache_size)
+			{
+				misses++;
+				load_time[index] = misses;
+			}
+		}
+
+		return static_cast<float>(misses) / static_cast<float>(triangle_count);
+	}
+
+}
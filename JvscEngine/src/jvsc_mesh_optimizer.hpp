@@ -0,0 +1,50 @@
+#pragma once
+
+// lib
+#include "jvsc_mesh.hpp"
+
+// std
+#include <vector>
+
+namespace jvsc {
+
+	struct MeshData
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	struct MeshOptimizeStats
+	{
+		uint32_t input_vertex_count = 0;
+		uint32_t output_vertex_count = 0;
+		uint32_t triangle_count = 0;
+		float acmr_before = 0.0f;	// average cache misses per triangle, 0.5 is ideal and 3.0 is the worst case
+		float acmr_after = 0.0f;
+	};
+
+	// Offline mesh processing: vertex deduplication, post-transform cache ordering
+	// (Forsyth's linear-speed algorithm) and vertex fetch ordering.
+	class JvscMeshOptimizer
+	{
+	public:
+
+		static constexpr uint32_t ACMR_CACHE_SIZE = 16;
+
+		// runs every stage below on a triangle list and reports the cache efficiency gained
+		static MeshOptimizeStats optimize(MeshData& mesh);
+
+		// builds an index buffer for a non-indexed triangle list, merging bitwise identical vertices
+		static MeshData deduplicate(const std::vector<Vertex>& vertices);
+
+		// reorders triangles so recently transformed vertices are reused
+		static void optimize_vertex_cache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+		// reorders vertices by first use so vertex fetch walks memory linearly, drops unused vertices
+		static void optimize_vertex_fetch(MeshData& mesh);
+
+		// simulates a FIFO post-transform cache of the given size
+		static float compute_acmr(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = ACMR_CACHE_SIZE);
+	};
+
+}
@@ -0,0 +1,173 @@
+#include "jvsc_mesh_optimizer.hpp"
+
+// lib
+#include <gtest/gtest.h>
+
+// std
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace jvsc {
+
+	namespace {
+
+		using Triangle = std::array<uint32_t, 3>;
+		using VertexKey = std::array<float, 5>;
+		using TriangleKey = std::array<VertexKey, 3>;
+
+		// rotated to start at its smallest corner, which keeps the winding
+		template<typename T>
+		std::array<T, 3> canonical(std::array<T, 3> corners)
+		{
+			std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+			return corners;
+		}
+
+		std::vector<Triangle> sorted_triangles(const std::vector<uint32_t>& indices)
+		{
+			std::vector<Triangle> triangles;
+			for (size_t i = 0; i + 2 < indices.size(); i += 3)
+				triangles.push_back(canonical(Triangle{ indices[i], indices[i + 1], indices[i + 2] }));
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		}
+
+		// the triangles as the vertices they draw, independent of how the vertices are indexed
+		std::vector<TriangleKey> sorted_geometry(const MeshData& mesh)
+		{
+			auto key = [&mesh](uint32_t index)
+			{
+				const Vertex& vertex = mesh.vertices[index];
+				return VertexKey{ vertex.position.x, vertex.position.y, vertex.color.r, vertex.color.g, vertex.color.b };
+			};
+
+			std::vector<TriangleKey> triangles;
+			for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+				triangles.push_back(canonical(TriangleKey{ key(mesh.indices[i]), key(mesh.indices[i + 1]), key(mesh.indices[i + 2]) }));
+			std::sort(triangles.begin(), triangles.end());
+			return triangles;
+		}
+
+		// size x size quads, two triangles each, in shuffled order so the cache has work to do
+		MeshData shuffled_grid(uint32_t size)
+		{
+			MeshData mesh{};
+			for (uint32_t y = 0; y <= size; y++)
+			{
+				for (uint32_t x = 0; x <= size; x++)
+					mesh.vertices.push_back(Vertex{ { static_cast<float>(x), static_cast<float>(y) }, { 1.f, 0.f, 0.f } });
+			}
+
+			std::vector<Triangle> triangles;
+			for (uint32_t y = 0; y < size; y++)
+			{
+				for (uint32_t x = 0; x < size; x++)
+				{
+					uint32_t corner = y * (size + 1) + x;
+					triangles.push_back(Triangle{ corner, corner + 1, corner + size + 1 });
+					triangles.push_back(Triangle{ corner + 1, corner + size + 2, corner + size + 1 });
+				}
+			}
+
+			std::shuffle(triangles.begin(), triangles.end(), std::mt19937{ 5 });
+			for (const Triangle& triangle : triangles)
+				mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+			return mesh;
+		}
+
+	}
+
+	TEST(MeshOptimizerTest, VertexCacheKeepsEveryTriangleAndWinding)
+	{
+		MeshData mesh = shuffled_grid(32);
+		std::vector<uint32_t> indices = mesh.indices;
+		uint32_t vertex_count = static_cast<uint32_t>(mesh.vertices.size());
+
+		JvscMeshOptimizer::optimize_vertex_cache(indices, vertex_count);
+
+		ASSERT_EQ(indices.size(), mesh.indices.size());
+		EXPECT_EQ(sorted_triangles(indices), sorted_triangles(mesh.indices));
+		EXPECT_LT(JvscMeshOptimizer::compute_acmr(indices, vertex_count), JvscMeshOptimizer::compute_acmr(mesh.indices, vertex_count));
+	}
+
+	TEST(MeshOptimizerTest, VertexCacheHandlesDegenerateInput)
+	{
+		std::vector<uint32_t> empty;
+		JvscMeshOptimizer::optimize_vertex_cache(empty, 0);
+		EXPECT_TRUE(empty.empty());
+
+		// a triangle repeated and one using a vertex twice both survive
+		std::vector<uint32_t> indices = { 0, 1, 2, 0, 1, 2, 3, 3, 4 };
+		std::vector<uint32_t> original = indices;
+		JvscMeshOptimizer::optimize_vertex_cache(indices, 5);
+		EXPECT_EQ(sorted_triangles(indices), sorted_triangles(original));
+	}
+
+	TEST(MeshOptimizerTest, DeduplicateMergesIdenticalVertices)
+	{
+		Vertex a{ { 0.f, 0.f }, { 1.f, 0.f, 0.f } };
+		Vertex b{ { 1.f, 0.f }, { 1.f, 0.f, 0.f } };
+		Vertex c{ { 0.f, 1.f }, { 1.f, 0.f, 0.f } };
+		// same position as c, other color
+		Vertex d{ { 0.f, 1.f }, { 0.f, 1.f, 0.f } };
+
+		MeshData mesh = JvscMeshOptimizer::deduplicate({ a, b, c, c, b, d });
+		EXPECT_EQ(mesh.vertices.size(), 4u);
+		EXPECT_EQ(mesh.indices, (std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3 }));
+	}
+
+	TEST(MeshOptimizerTest, VertexFetchOrdersByFirstUseAndDropsUnused)
+	{
+		MeshData mesh{};
+		for (uint32_t i = 0; i < 6; i++)
+			mesh.vertices.push_back(Vertex{ { static_cast<float>(i), 0.f }, { 0.f, 0.f, 1.f } });
+		mesh.indices = { 4, 2, 5, 5, 2, 0 };
+		MeshData original = mesh;
+
+		JvscMeshOptimizer::optimize_vertex_fetch(mesh);
+
+		EXPECT_EQ(mesh.vertices.size(), 4u);
+		EXPECT_EQ(mesh.indices, (std::vector<uint32_t>{ 0, 1, 2, 2, 1, 3 }));
+		EXPECT_EQ(sorted_geometry(mesh), sorted_geometry(original));
+	}
+
+	TEST(MeshOptimizerTest, OptimizeKeepsGeometry)
+	{
+		MeshData mesh = shuffled_grid(16);
+		MeshData original = mesh;
+
+		MeshOptimizeStats stats = JvscMeshOptimizer::optimize(mesh);
+
+		EXPECT_EQ(stats.triangle_count, original.indices.size() / 3);
+		EXPECT_EQ(stats.output_vertex_count, mesh.vertices.size());
+		EXPECT_LE(stats.acmr_after, stats.acmr_before);
+		EXPECT_EQ(sorted_geometry(mesh), sorted_geometry(original));
+
+		// fetch order: every vertex is first used after the ones before it
+		uint32_t next_new = 0;
+		for (uint32_t index : mesh.indices)
+		{
+			ASSERT_LE(index, next_new);
+			if (index == next_new)
+				next_new++;
+		}
+		EXPECT_EQ(next_new, mesh.vertices.size());
+	}
+
+	TEST(MeshOptimizerTest, OptimizeIndexesTriangleSoup)
+	{
+		MeshData indexed = shuffled_grid(4);
+		MeshData soup{};
+		for (uint32_t index : indexed.indices)
+			soup.vertices.push_back(indexed.vertices[index]);
+
+		MeshOptimizeStats stats = JvscMeshOptimizer::optimize(soup);
+
+		EXPECT_EQ(stats.input_vertex_count, indexed.indices.size());
+		EXPECT_EQ(stats.output_vertex_count, indexed.vertices.size());
+		EXPECT_EQ(sorted_geometry(soup), sorted_geometry(indexed));
+	}
+
+}
@@ -0,0 +1,153 @@
+#include "jvsc_mesh_pool.hpp"
+#include "jvsc_uploader.hpp"
+
+// std
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace jvsc {
+
+	JvscMeshPool::JvscMeshPool(JvscRenderer& renderer, uint32_t vertex_stride, VkDeviceSize block_vertex_count, VkDeviceSize block_index_count)
+		: m_renderer{renderer}
+		, m_vertex_stride{vertex_stride}
+		, m_block_vertex_count{block_vertex_count}
+		, m_block_index_count{block_index_count}
+	{
+		std::cout << "calling mesh pool constructor" << '\n';
+	}
+
+	void JvscMeshPool::terminate()
+	{
+		std::cout << "calling mesh pool destructor" << '\n';
+
+		for (auto& block : m_blocks)
+		{
+			// meshes that were never destroyed still hold suballocations
+			vmaClearVirtualBlock(block.vertex_block);
+			vmaClearVirtualBlock(block.index_block);
+			vmaDestroyVirtualBlock(block.vertex_block);
+			vmaDestroyVirtualBlock(block.index_block);
+			vmaDestroyBuffer(m_renderer.allocator(), block.vertex_buffer, block.vertex_buffer_allocation);
+			vmaDestroyBuffer(m_renderer.allocator(), block.index_buffer, block.index_buffer_allocation);
+		}
+		m_blocks.clear();
+	}
+
+	MeshAllocation JvscMeshPool::allocate(const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count)
+	{
+		MeshAllocation allocation{};
+
+		bool allocated = false;
+		for (uint32_t i = 0; i < m_blocks.size() && !allocated; i++)
+		{
+			allocation.block = i;
+			allocated = try_allocate(m_blocks[i], vertex_count, index_count, allocation);
+		}
+
+		if (!allocated)
+		{
+			create_block(std::max<VkDeviceSize>(m_block_vertex_count, vertex_count), std::max<VkDeviceSize>(m_block_index_count, index_count));
+			allocation.block = static_cast<uint32_t>(m_blocks.size() - 1);
+			if (!try_allocate(m_blocks.back(), vertex_count, index_count, allocation))
+				throw std::runtime_error("failed to allocate mesh from pool");
+		}
+
+		Block& block = m_blocks[allocation.block];
+		JvscUploader& uploader = m_renderer.uploader();
+		uploader.upload_buffer(block.vertex_buffer, static_cast<VkDeviceSize>(allocation.first_vertex) * m_vertex_stride, vertices, static_cast<VkDeviceSize>(vertex_count) * m_vertex_stride);
+		if (index_count > 0)
+			uploader.upload_buffer(block.index_buffer, static_cast<VkDeviceSize>(allocation.first_index) * sizeof(uint32_t), indices, static_cast<VkDeviceSize>(index_count) * sizeof(uint32_t));
+
+		return allocation;
+	}
+
+	void JvscMeshPool::free(const MeshAllocation& allocation)
+	{
+		// frames in flight may still draw from the ranges, a new mesh must not be uploaded over them before they finish
+		m_renderer.defer_destruction([this, allocation]()
+		{
+			Block& block = m_blocks[allocation.block];
+			if (allocation.vertex_allocation != VK_NULL_HANDLE)
+				vmaVirtualFree(block.vertex_block, allocation.vertex_allocation);
+			if (allocation.index_allocation != VK_NULL_HANDLE)
+				vmaVirtualFree(block.index_block, allocation.index_allocation);
+		});
+	}
+
+	void JvscMeshPool::bind(VkCommandBuffer cmd, uint32_t block)
+	{
+		VkBuffer buffers[] = { m_blocks[block].vertex_buffer };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(cmd, 0, 1, buffers, offsets);
+		vkCmdBindIndexBuffer(cmd, m_blocks[block].index_buffer, 0, VK_INDEX_TYPE_UINT32);
+	}
+
+	void JvscMeshPool::create_block(VkDeviceSize vertex_count, VkDeviceSize index_count)
+	{
+		Block block{};
+
+		VkBufferCreateInfo buffer_info{};
+		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size = vertex_count * m_vertex_stride;
+		buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo alloc_info{};
+		alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+		if (vmaCreateBuffer(m_renderer.allocator(), &buffer_info, &alloc_info, &block.vertex_buffer, &block.vertex_buffer_allocation, nullptr) != VK_SUCCESS)
+			throw std::runtime_error("failed to create mesh pool vertex buffer");
+
+		buffer_info.size = index_count * sizeof(uint32_t);
+		buffer_info.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		if (vmaCreateBuffer(m_renderer.allocator(), &buffer_info, &alloc_info, &block.index_buffer, &block.index_buffer_allocation, nullptr) != VK_SUCCESS)
+			throw std::runtime_error("failed to create mesh pool index buffer");
+
+		// virtual blocks are sized in elements, not bytes
+		VmaVirtualBlockCreateInfo block_info{};
+		block_info.size = vertex_count;
+		if (vmaCreateVirtualBlock(&block_info, &block.vertex_block) != VK_SUCCESS)
+			throw std::runtime_error("failed to create mesh pool vertex block");
+
+		block_info.size = index_count;
+		if (vmaCreateVirtualBlock(&block_info, &block.index_block) != VK_SUCCESS)
+			throw std::runtime_error("failed to create mesh pool index block");
+
+		m_blocks.push_back(block);
+	}
+
+	bool JvscMeshPool::try_allocate(Block& block, uint32_t vertex_count, uint32_t index_count, MeshAllocation& allocation)
+	{
+		VmaVirtualAllocationCreateInfo vertex_info{};
+		vertex_info.size = vertex_count;
+
+		VkDeviceSize vertex_offset;
+		if (vmaVirtualAllocate(block.vertex_block, &vertex_info, &allocation.vertex_allocation, &vertex_offset) != VK_SUCCESS)
+		{
+			allocation.vertex_allocation = VK_NULL_HANDLE;
+			return false;
+		}
+
+		VkDeviceSize index_offset = 0;
+		if (index_count > 0)
+		{
+			VmaVirtualAllocationCreateInfo index_info{};
+			index_info.size = index_count;
+
+			if (vmaVirtualAllocate(block.index_block, &index_info, &allocation.index_allocation, &index_offset) != VK_SUCCESS)
+			{
+				vmaVirtualFree(block.vertex_block, allocation.vertex_allocation);
+				allocation.vertex_allocation = VK_NULL_HANDLE;
+				allocation.index_allocation = VK_NULL_HANDLE;
+				return false;
+			}
+		}
+
+		allocation.first_vertex = static_cast<uint32_t>(vertex_offset);
+		allocation.first_index = static_cast<uint32_t>(index_offset);
+		return true;
+	}
+
+}
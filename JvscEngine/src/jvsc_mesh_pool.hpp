@@ -0,0 +1,73 @@
+#pragma once
+
+// lib
+#include "jvsc_renderer.hpp"
+
+// std
+#include <vector>
+
+namespace jvsc {
+
+	// where a mesh lives inside the pool, offsets are in elements rather than bytes
+	struct MeshAllocation
+	{
+		uint32_t block = 0;
+		VmaVirtualAllocation vertex_allocation = VK_NULL_HANDLE;
+		VmaVirtualAllocation index_allocation = VK_NULL_HANDLE;
+		uint32_t first_vertex = 0;
+		uint32_t first_index = 0;
+	};
+
+	// Suballocates vertex and index data of every mesh from a few large device-local buffers.
+	// Each block pairs a vertex buffer with an index buffer, managed by VMA virtual blocks
+	// sized in vertices and indices so suballocations always land on element boundaries.
+	class JvscMeshPool
+	{
+	public:
+
+		static constexpr VkDeviceSize DEFAULT_BLOCK_VERTEX_COUNT = 1 << 20;
+		static constexpr VkDeviceSize DEFAULT_BLOCK_INDEX_COUNT = 4 << 20;
+
+		JvscMeshPool(JvscRenderer& renderer, uint32_t vertex_stride, VkDeviceSize block_vertex_count = DEFAULT_BLOCK_VERTEX_COUNT, VkDeviceSize block_index_count = DEFAULT_BLOCK_INDEX_COUNT);
+		~JvscMeshPool() = default;
+		void terminate();
+
+		JvscMeshPool(const JvscMeshPool&) = delete;
+		JvscMeshPool& operator=(const JvscMeshPool&) = delete;
+
+		// reserves space and queues the upload through the renderer's uploader
+		MeshAllocation allocate(const void* vertices, uint32_t vertex_count, const uint32_t* indices, uint32_t index_count);
+		// the ranges become free through JvscRenderer::defer_destruction(), once submitted frames are done with them
+		void free(const MeshAllocation& allocation);
+
+		// binds the block's vertex buffer to binding 0 and its index buffer
+		void bind(VkCommandBuffer cmd, uint32_t block);
+
+		uint32_t block_count() const { return static_cast<uint32_t>(m_blocks.size()); }
+		VkBuffer vertex_buffer(uint32_t block) const { return m_blocks[block].vertex_buffer; }
+		VkBuffer index_buffer(uint32_t block) const { return m_blocks[block].index_buffer; }
+
+	private:
+
+		struct Block
+		{
+			VkBuffer vertex_buffer;
+			VmaAllocation vertex_buffer_allocation;
+			VmaVirtualBlock vertex_block;
+			VkBuffer index_buffer;
+			VmaAllocation index_buffer_allocation;
+			VmaVirtualBlock index_block;
+		};
+
+		void create_block(VkDeviceSize vertex_count, VkDeviceSize index_count);
+		bool try_allocate(Block& block, uint32_t vertex_count, uint32_t index_count, MeshAllocation& allocation);
+
+		JvscRenderer& m_renderer;
+
+		uint32_t m_vertex_stride;
+		VkDeviceSize m_block_vertex_count;
+		VkDeviceSize m_block_index_count;
+		std::vector<Block> m_blocks;
+	};
+
+}
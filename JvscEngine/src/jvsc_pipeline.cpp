@@ -2,11 +2,13 @@
 
 // lib
 #include "jvsc_mesh.hpp"
+#include "jvsc_shader_registry.hpp"
 
 // std
 #include <cassert>
-#include <fstream>
+#include <chrono>
 #include <iostream>
+#include <sstream>
 
 
 namespace jvsc {
@@ -15,7 +17,19 @@ namespace jvsc {
 		: m_renderer{renderer}
 	{
 		std::cout << "calling pipeline constructor" << '\n';
-		create_graphics_pipeline(vertex_filepath, fragment_filepath, pipeline_builder);
+		m_vert_shader_module = m_renderer.shader_registry().load(vertex_filepath);
+		m_frag_shader_module = m_renderer.shader_registry().load(fragment_filepath);
+		create_graphics_pipeline(pipeline_builder, vertex_filepath + " + " + fragment_filepath);
+	}
+
+	JvscPipeline::JvscPipeline(JvscRenderer& renderer, VkShaderModule vertex_module, VkShaderModule fragment_module, const PipelineBuilder& pipeline_builder, const std::string& name)
+		: m_renderer{renderer}
+		, m_vert_shader_module{vertex_module}
+		, m_frag_shader_module{fragment_module}
+	{
+		// one write, this constructor runs on job system workers
+		std::cout << "calling pipeline constructor\n";
+		create_graphics_pipeline(pipeline_builder, name);
 	}
 
 	void JvscPipeline::destroy()
@@ -28,6 +42,19 @@ namespace jvsc {
 	void JvscPipeline::bind(VkCommandBuffer cmd)
 	{
 		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphics_pipeline);
+
+		if (!m_extended_dynamic_state)
+			return;
+
+		// dynamic state outlives the bind, so callers may still override any of these afterwards
+		const ExtendedDynamicState& ext = m_renderer.extended_dynamic_state();
+		const ExtendedDynamicStateValues& values = m_extended_dynamic_state_values;
+		ext.set_cull_mode(cmd, values.cull_mode);
+		ext.set_front_face(cmd, values.front_face);
+		ext.set_primitive_topology(cmd, values.topology);
+		ext.set_depth_test_enable(cmd, values.depth_test_enable);
+		ext.set_depth_write_enable(cmd, values.depth_write_enable);
+		ext.set_depth_compare_op(cmd, values.depth_compare_op);
 	}
 
 	void JvscPipeline::default_pipeline_builder(PipelineBuilder& pipeline_builder)
@@ -91,20 +118,35 @@ namespace jvsc {
 		pipeline_builder.depthStencilInfo.front = {}; // Optional
 		pipeline_builder.depthStencilInfo.back = {}; // Optional
 		
-		pipeline_builder.dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		pipeline_builder.dynamicStateInfo.flags = 0;
+		// set per command buffer (JvscRenderer::set_swapchain_viewport), a new extent does not rebuild pipelines
+		pipeline_builder.dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		pipeline_builder.bindingDescriptions = Vertex::get_binding_descriptions();
+		pipeline_builder.attributeDescriptions = Vertex::get_attribute_descriptions();
 	}
 
-	void JvscPipeline::create_graphics_pipeline(const std::string& vertex_filepath, const std::string& fragment_filepath, const PipelineBuilder& pipeline_builder)
+	void JvscPipeline::swapchain_attachments(const JvscRenderer& renderer, PipelineBuilder& pipeline_builder)
+	{
+		pipeline_builder.colorAttachmentFormats = { renderer.image_format() };
+		pipeline_builder.depthAttachmentFormat = renderer.depth_format();
+	}
+
+	void JvscPipeline::create_graphics_pipeline(const PipelineBuilder& pipeline_builder, const std::string& name)
 	{
 		assert(pipeline_builder.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no VkPipelineLayout provided in configInfo");
-		assert(pipeline_builder.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no VkRenderPass provided in configInfo");
+		assert((pipeline_builder.renderPass != VK_NULL_HANDLE || !pipeline_builder.colorAttachmentFormats.empty()) && "Cannot create graphics pipeline: no VkRenderPass or attachment formats provided in configInfo");
 
-		auto vert_code = read_file(vertex_filepath);
-		auto frag_code = read_file(fragment_filepath);
+		VkSpecializationInfo vertex_specialization{};
+		vertex_specialization.mapEntryCount = static_cast<uint32_t>(pipeline_builder.vertexConstants.entries.size());
+		vertex_specialization.pMapEntries = pipeline_builder.vertexConstants.entries.data();
+		vertex_specialization.dataSize = pipeline_builder.vertexConstants.data.size();
+		vertex_specialization.pData = pipeline_builder.vertexConstants.data.data();
 
-		create_shader_module(vert_code, &m_vert_shader_module);
-		create_shader_module(frag_code, &m_frag_shader_module);
+		VkSpecializationInfo fragment_specialization{};
+		fragment_specialization.mapEntryCount = static_cast<uint32_t>(pipeline_builder.fragmentConstants.entries.size());
+		fragment_specialization.pMapEntries = pipeline_builder.fragmentConstants.entries.data();
+		fragment_specialization.dataSize = pipeline_builder.fragmentConstants.data.size();
+		fragment_specialization.pData = pipeline_builder.fragmentConstants.data.data();
 
 		VkPipelineShaderStageCreateInfo shader_stages[2];
 		shader_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -113,7 +155,7 @@ namespace jvsc {
 		shader_stages[0].pName = "main";
 		shader_stages[0].flags = 0;
 		shader_stages[0].pNext = nullptr;
-		shader_stages[0].pSpecializationInfo = nullptr;
+		shader_stages[0].pSpecializationInfo = pipeline_builder.vertexConstants.empty() ? nullptr : &vertex_specialization;
 	
 		shader_stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shader_stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -121,10 +163,10 @@ namespace jvsc {
 		shader_stages[1].pName = "main";
 		shader_stages[1].flags = 0;
 		shader_stages[1].pNext = nullptr;
-		shader_stages[1].pSpecializationInfo = nullptr;
+		shader_stages[1].pSpecializationInfo = pipeline_builder.fragmentConstants.empty() ? nullptr : &fragment_specialization;
 
-		auto binding_descriptions = Vertex::get_binding_descriptions();
-		auto attribute_descriptions = Vertex::get_attribute_descriptions();
+		const auto& binding_descriptions = pipeline_builder.bindingDescriptions;
+		const auto& attribute_descriptions = pipeline_builder.attributeDescriptions;
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(binding_descriptions.size());
@@ -132,6 +174,31 @@ namespace jvsc {
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute_descriptions.size());
 		vertexInputInfo.pVertexAttributeDescriptions = attribute_descriptions.data();
 
+		std::vector<VkDynamicState> dynamic_states = pipeline_builder.dynamicStates;
+		m_extended_dynamic_state = m_renderer.supports_extended_dynamic_state();
+		if (m_extended_dynamic_state)
+		{
+			dynamic_states.insert(dynamic_states.end(), {
+				VK_DYNAMIC_STATE_CULL_MODE_EXT,
+				VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+				VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+				VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+				VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+				VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT });
+
+			m_extended_dynamic_state_values.cull_mode = pipeline_builder.rasterizationInfo.cullMode;
+			m_extended_dynamic_state_values.front_face = pipeline_builder.rasterizationInfo.frontFace;
+			m_extended_dynamic_state_values.topology = pipeline_builder.inputAssembly.topology;
+			m_extended_dynamic_state_values.depth_test_enable = pipeline_builder.depthStencilInfo.depthTestEnable;
+			m_extended_dynamic_state_values.depth_write_enable = pipeline_builder.depthStencilInfo.depthWriteEnable;
+			m_extended_dynamic_state_values.depth_compare_op = pipeline_builder.depthStencilInfo.depthCompareOp;
+		}
+
+		VkPipelineDynamicStateCreateInfo dynamic_state_info{};
+		dynamic_state_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size());
+		dynamic_state_info.pDynamicStates = dynamic_states.data();
+
 		VkGraphicsPipelineCreateInfo pipeline_info{};
 		pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
 		pipeline_info.stageCount = 2;
@@ -143,48 +210,84 @@ namespace jvsc {
 		pipeline_info.pMultisampleState = &pipeline_builder.multisampleInfo;
 		pipeline_info.pColorBlendState = &pipeline_builder.colorBlendInfo;
 		pipeline_info.pDepthStencilState = &pipeline_builder.depthStencilInfo;
-		pipeline_info.pDynamicState = &pipeline_builder.dynamicStateInfo;
+		pipeline_info.pDynamicState = &dynamic_state_info;
 	
 		pipeline_info.layout = pipeline_builder.pipelineLayout;
 		pipeline_info.renderPass = pipeline_builder.renderPass;
 		pipeline_info.subpass = pipeline_builder.subpass;
 
+		VkPipelineRenderingCreateInfoKHR rendering_info{};
+		if (pipeline_builder.renderPass == VK_NULL_HANDLE)
+		{
+			rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+			rendering_info.colorAttachmentCount = static_cast<uint32_t>(pipeline_builder.colorAttachmentFormats.size());
+			rendering_info.pColorAttachmentFormats = pipeline_builder.colorAttachmentFormats.data();
+			// stencil stays VK_FORMAT_UNDEFINED, the renderer never binds a stencil attachment
+			rendering_info.depthAttachmentFormat = pipeline_builder.depthAttachmentFormat;
+			pipeline_info.pNext = &rendering_info;
+			pipeline_info.subpass = 0;
+		}
+
 		pipeline_info.basePipelineIndex = -1;
 		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-		if (vkCreateGraphicsPipelines(m_renderer.device(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS)
+		auto start = std::chrono::steady_clock::now();
+
+		if (vkCreateGraphicsPipelines(m_renderer.device(), m_renderer.pipeline_cache(), 1, &pipeline_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS)
 			throw std::runtime_error("failed to create graphics pipeline");
 
-		vkDestroyShaderModule(m_renderer.device(), m_vert_shader_module, nullptr);
-		vkDestroyShaderModule(m_renderer.device(), m_frag_shader_module, nullptr);
+		auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+		// compiles run on job system workers, one write keeps the line from interleaving with other threads' output
+		std::ostringstream line;
+		line << "pipeline " << name << " created in " << elapsed.count() << " ms (" << (m_renderer.pipeline_cache_warm() ? "warm" : "cold") << " cache)" << '\n';
+		std::cout << line.str();
 	}
 
-	void JvscPipeline::create_shader_module(const std::vector<char>& code, VkShaderModule* shader_module)
+	JvscComputePipeline::JvscComputePipeline(JvscRenderer& renderer, const std::string& compute_filepath, VkPipelineLayout pipeline_layout)
+		: m_renderer{renderer}
 	{
-		VkShaderModuleCreateInfo create_info{};
-		create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		create_info.codeSize = code.size();
-		create_info.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		std::cout << "calling compute pipeline constructor" << '\n';
+		create_compute_pipeline(compute_filepath, pipeline_layout);
+	}
 
-		if (vkCreateShaderModule(m_renderer.device(), &create_info, nullptr, shader_module) != VK_SUCCESS)
-			throw std::runtime_error("failed to create shader module");
+	void JvscComputePipeline::destroy()
+	{
+		std::cout << "calling compute pipeline destructor" << '\n';
+		vkDestroyPipeline(m_renderer.device(), m_compute_pipeline, nullptr);
 	}
 
-	std::vector<char> JvscPipeline::read_file(const std::string& filepath)
+	void JvscComputePipeline::bind(VkCommandBuffer cmd)
 	{
-		std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_pipeline);
+	}
 
-		if (!file.is_open())
-			throw std::runtime_error("failed to open file: " + filepath);
+	void JvscComputePipeline::create_compute_pipeline(const std::string& compute_filepath, VkPipelineLayout pipeline_layout)
+	{
+		assert(pipeline_layout != VK_NULL_HANDLE && "Cannot create compute pipeline: no VkPipelineLayout provided");
+
+		m_compute_shader_module = m_renderer.shader_registry().load(compute_filepath);
+
+		VkPipelineShaderStageCreateInfo shader_stage{};
+		shader_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shader_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		shader_stage.module = m_compute_shader_module;
+		shader_stage.pName = "main";
+
+		VkComputePipelineCreateInfo pipeline_info{};
+		pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipeline_info.stage = shader_stage;
+		pipeline_info.layout = pipeline_layout;
+		pipeline_info.basePipelineIndex = -1;
+		pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-		size_t file_size = static_cast<size_t>(file.tellg());
-		std::vector<char> buffer(file_size);
+		auto start = std::chrono::steady_clock::now();
 
-		file.seekg(0);
-		file.read(buffer.data(), file_size);
+		if (vkCreateComputePipelines(m_renderer.device(), m_renderer.pipeline_cache(), 1, &pipeline_info, nullptr, &m_compute_pipeline) != VK_SUCCESS)
+			throw std::runtime_error("failed to create compute pipeline");
 
-		file.close();
-		return buffer;
+		auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+		std::cout << "compute pipeline " << compute_filepath << " created in " << elapsed.count() << " ms (" << (m_renderer.pipeline_cache_warm() ? "warm" : "cold") << " cache)" << '\n';
 	}
 
 
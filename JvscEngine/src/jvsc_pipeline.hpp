@@ -4,11 +4,48 @@
 #include "jvsc_renderer.hpp"
 
 // std
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace jvsc {
 
+	// Specialization constant values for one shader stage, given in constant_id order (0, 1, ...) with
+	// their types spelled out: from<VkBool32, float>(VK_TRUE, 0.5f). Only the types GLSL scalar constants
+	// map to are accepted, VkBool32 for a bool, int32_t, uint32_t and float. Each set of values is its
+	// own pipeline variant.
+	struct SpecializationConstants
+	{
+		std::vector<VkSpecializationMapEntry> entries;
+		std::vector<uint8_t> data;
+
+		template<typename... Types>
+		static SpecializationConstants from(Types... values)
+		{
+			static_assert(((std::is_same<Types, int32_t>::value || std::is_same<Types, uint32_t>::value || std::is_same<Types, float>::value) && ...),
+				"specialization constants must be VkBool32, int32_t, uint32_t or float");
+
+			SpecializationConstants constants;
+			(constants.add(values), ...);
+			return constants;
+		}
+
+		bool empty() const { return entries.empty(); }
+
+	private:
+
+		template<typename T>
+		void add(T value)
+		{
+			uint32_t offset = static_cast<uint32_t>(data.size());
+			entries.push_back(VkSpecializationMapEntry{ static_cast<uint32_t>(entries.size()), offset, sizeof(T) });
+			data.resize(offset + sizeof(T));
+			std::memcpy(data.data() + offset, &value, sizeof(T));
+		}
+	};
+
 	struct PipelineBuilder
 	{
 		PipelineBuilder& operator=(const PipelineBuilder&) = delete;
@@ -20,10 +57,20 @@ namespace jvsc {
 		VkPipelineColorBlendAttachmentState colorBlendAttachment;
 		VkPipelineColorBlendStateCreateInfo colorBlendInfo;
 		VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
-		VkPipelineDynamicStateCreateInfo dynamicStateInfo;
+		// viewport and scissor by default, JvscPipeline adds the extended dynamic states the renderer supports
+		std::vector<VkDynamicState> dynamicStates;
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 		VkPipelineLayout pipelineLayout = nullptr;
+		// render pass path, leave it null to build for dynamic rendering from the formats below
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		// dynamic rendering path, the attachments vkCmdBeginRenderingKHR will be given
+		std::vector<VkFormat> colorAttachmentFormats;
+		VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+		// empty leaves the shader's default constant values
+		SpecializationConstants vertexConstants;
+		SpecializationConstants fragmentConstants;
 	};
 
 	class JvscPipeline
@@ -31,6 +78,8 @@ namespace jvsc {
 	public:
 
 		JvscPipeline(JvscRenderer& renderer, const std::string& vertex_filepath, const std::string& fragment_filepath, const PipelineBuilder& pipeline_builder);
+		// modules already loaded from the shader registry, safe on any thread; name is only logged
+		JvscPipeline(JvscRenderer& renderer, VkShaderModule vertex_module, VkShaderModule fragment_module, const PipelineBuilder& pipeline_builder, const std::string& name);
 		~JvscPipeline() = default;
 		void destroy();
 
@@ -40,21 +89,59 @@ namespace jvsc {
 		void bind(VkCommandBuffer cmd);
 
 		static void default_pipeline_builder(PipelineBuilder& pipeline_builder);
+		// attachment formats of begin_swapchain_render_pass(), what the builder needs when the renderer has no render pass
+		static void swapchain_attachments(const JvscRenderer& renderer, PipelineBuilder& pipeline_builder);
 
 	private:
 
-		void create_graphics_pipeline(const std::string& vertex_filepath, const std::string& fragment_filepath, const PipelineBuilder& pipeline_builder);
-
-		void create_shader_module(const std::vector<char>& code, VkShaderModule* shader_module);
+		void create_graphics_pipeline(const PipelineBuilder& pipeline_builder, const std::string& name);
 
-		static std::vector<char> read_file(const std::string& filepath);
+		// the builder's values for the states VK_EXT_extended_dynamic_state makes dynamic, set by bind()
+		struct ExtendedDynamicStateValues
+		{
+			VkCullModeFlags cull_mode;
+			VkFrontFace front_face;
+			VkPrimitiveTopology topology;
+			VkBool32 depth_test_enable;
+			VkBool32 depth_write_enable;
+			VkCompareOp depth_compare_op;
+		};
 
 		JvscRenderer& m_renderer;
 
 		VkPipeline m_graphics_pipeline;
+		bool m_extended_dynamic_state = false;
+		ExtendedDynamicStateValues m_extended_dynamic_state_values{};
+		// owned by the renderer's shader registry
 		VkShaderModule m_vert_shader_module;
 		VkShaderModule m_frag_shader_module;
 
 	};
 
+	// a single compute shader, created through the same shader registry and pipeline cache as JvscPipeline
+	class JvscComputePipeline
+	{
+	public:
+
+		JvscComputePipeline(JvscRenderer& renderer, const std::string& compute_filepath, VkPipelineLayout pipeline_layout);
+		~JvscComputePipeline() = default;
+		void destroy();
+
+		JvscComputePipeline(const JvscComputePipeline&) = delete;
+		JvscComputePipeline& operator=(JvscComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer cmd);
+
+	private:
+
+		void create_compute_pipeline(const std::string& compute_filepath, VkPipelineLayout pipeline_layout);
+
+		JvscRenderer& m_renderer;
+
+		VkPipeline m_compute_pipeline;
+		// owned by the renderer's shader registry
+		VkShaderModule m_compute_shader_module;
+
+	};
+
 }
\ No newline at end of file
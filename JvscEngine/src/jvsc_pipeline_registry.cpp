@@ -0,0 +1,319 @@
+#include "jvsc_pipeline_registry.hpp"
+
+// lib
+#include "jvsc_profiler.hpp"
+#include "jvsc_shader_registry.hpp"
+
+// std
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace jvsc {
+
+	namespace {
+
+		// the state as bytes one field at a time, the padding inside the Vulkan structs is never read
+		class StateWriter
+		{
+		public:
+
+			template<typename T>
+			void add(const T& value)
+			{
+				static_assert(std::is_scalar<T>::value, "write struct fields one at a time");
+				char bytes[sizeof(T)];
+				std::memcpy(bytes, &value, sizeof(T));
+				m_bytes.append(bytes, sizeof(T));
+			}
+
+			void add(const VkStencilOpState& state)
+			{
+				add(state.failOp);
+				add(state.passOp);
+				add(state.depthFailOp);
+				add(state.compareOp);
+				add(state.compareMask);
+				add(state.writeMask);
+				add(state.reference);
+			}
+
+			void add(const SpecializationConstants& constants)
+			{
+				add(constants.entries.size());
+				for (const VkSpecializationMapEntry& entry : constants.entries)
+				{
+					add(entry.constantID);
+					add(entry.offset);
+					add(entry.size);
+				}
+				for (uint8_t byte : constants.data)
+					add(byte);
+			}
+
+			std::string take() { return std::move(m_bytes); }
+
+		private:
+
+			std::string m_bytes;
+		};
+
+		uint64_t hash_bytes(const std::string& bytes)
+		{
+			// FNV-1a
+			uint64_t hash = 14695981039346656037ull;
+			for (char byte : bytes)
+			{
+				hash ^= static_cast<unsigned char>(byte);
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+
+	}
+
+	JvscPipelineRegistry::JvscPipelineRegistry(JvscRenderer& renderer)
+		: m_renderer{renderer}
+	{
+		std::cout << "calling pipeline registry constructor" << '\n';
+	}
+
+	void JvscPipelineRegistry::terminate()
+	{
+		std::cout << "calling pipeline registry destructor" << '\n';
+
+		for (auto& [hash, pipelines] : m_pipelines)
+		{
+			for (auto& pipeline : pipelines)
+				retire(*pipeline);
+		}
+		m_pipelines.clear();
+		m_pipeline_count = 0;
+	}
+
+	SharedPipeline& JvscPipelineRegistry::request(const std::string& vertex_filepath, const std::string& fragment_filepath, const PipelineBuilder& pipeline_builder)
+	{
+		VkShaderModule vertex_module = m_renderer.shader_registry().load(vertex_filepath);
+		VkShaderModule fragment_module = m_renderer.shader_registry().load(fragment_filepath);
+		std::string state = serialize_state(vertex_module, fragment_module, pipeline_builder);
+
+		// the hash only finds the candidates, a pipeline is shared only with an identical state
+		std::vector<std::unique_ptr<SharedPipeline>>& candidates = m_pipelines[hash_bytes(state)];
+		for (auto& candidate : candidates)
+		{
+			if (candidate->m_state == state)
+			{
+				m_shared_requests++;
+				return *candidate;
+			}
+		}
+
+		auto pipeline = std::make_unique<SharedPipeline>();
+		SharedPipeline* entry = pipeline.get();
+		entry->m_state = std::move(state);
+		entry->m_layout = pipeline_builder.pipelineLayout;
+		entry->m_name = vertex_filepath + " + " + fragment_filepath;
+		entry->m_builder = std::make_unique<PipelineBuilder>(pipeline_builder);
+		// the one pointer default_pipeline_builder() leaves into the builder itself
+		if (pipeline_builder.colorBlendInfo.pAttachments == &pipeline_builder.colorBlendAttachment)
+			entry->m_builder->colorBlendInfo.pAttachments = &entry->m_builder->colorBlendAttachment;
+		candidates.push_back(std::move(pipeline));
+		m_pipeline_count++;
+
+		JvscJobSystem::get().run([this, entry, vertex_module, fragment_module]()
+		{
+			JVSC_PROFILE_SCOPE("pipeline compile");
+
+			// jobs must not throw, a failed compile is reported through the entry instead
+			try
+			{
+				JvscPipeline* compiled = new JvscPipeline(m_renderer, vertex_module, fragment_module, *entry->m_builder, entry->m_name);
+				entry->m_pipeline.store(compiled, std::memory_order_release);
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "pipeline " + entry->m_name + ": " + e.what() + '\n';
+				entry->m_failed.store(true, std::memory_order_release);
+			}
+			entry->m_builder.reset();
+		}, &entry->m_compiling);
+
+		return *entry;
+	}
+
+	JvscPipeline& JvscPipelineRegistry::wait(SharedPipeline& pipeline)
+	{
+		if (!pipeline.m_compiling.done())
+			JvscJobSystem::get().wait(pipeline.m_compiling);
+
+		if (pipeline.failed())
+			throw std::runtime_error("failed to create graphics pipeline " + pipeline.m_name);
+		return *pipeline.get();
+	}
+
+	void JvscPipelineRegistry::wait_all()
+	{
+		for (auto& [hash, pipelines] : m_pipelines)
+		{
+			for (auto& pipeline : pipelines)
+				wait(*pipeline);
+		}
+	}
+
+	void JvscPipelineRegistry::release_layout(VkPipelineLayout layout)
+	{
+		for (auto it = m_pipelines.begin(); it != m_pipelines.end();)
+		{
+			std::vector<std::unique_ptr<SharedPipeline>>& pipelines = it->second;
+			for (size_t i = 0; i < pipelines.size();)
+			{
+				if (pipelines[i]->m_layout != layout)
+				{
+					i++;
+					continue;
+				}
+
+				retire(*pipelines[i]);
+				pipelines.erase(pipelines.begin() + i);
+				m_pipeline_count--;
+			}
+
+			if (pipelines.empty())
+				it = m_pipelines.erase(it);
+			else
+				++it;
+		}
+	}
+
+	size_t JvscPipelineRegistry::pending_count() const
+	{
+		size_t pending = 0;
+		for (const auto& [hash, pipelines] : m_pipelines)
+		{
+			for (const auto& pipeline : pipelines)
+			{
+				if (!pipeline->m_compiling.done())
+					pending++;
+			}
+		}
+		return pending;
+	}
+
+	void JvscPipelineRegistry::retire(SharedPipeline& pipeline)
+	{
+		if (!pipeline.m_compiling.done())
+			JvscJobSystem::get().wait(pipeline.m_compiling);
+
+		JvscPipeline* compiled = pipeline.m_pipeline.exchange(nullptr);
+		if (!compiled)
+			return;
+
+		m_renderer.defer_destruction([compiled]()
+		{
+			compiled->destroy();
+			delete compiled;
+		});
+	}
+
+	std::string JvscPipelineRegistry::serialize_state(VkShaderModule vertex_module, VkShaderModule fragment_module, const PipelineBuilder& pipeline_builder)
+	{
+		// the shader registry shares a module only between identical SPIR-V, so a module handle stands for its code
+		StateWriter writer;
+		writer.add(vertex_module);
+		writer.add(fragment_module);
+
+		const VkPipelineInputAssemblyStateCreateInfo& input_assembly = pipeline_builder.inputAssembly;
+		writer.add(input_assembly.topology);
+		writer.add(input_assembly.primitiveRestartEnable);
+
+		// pointers are dynamic state by default, only the counts are part of the pipeline then
+		writer.add(pipeline_builder.viewportInfo.viewportCount);
+		writer.add(pipeline_builder.viewportInfo.scissorCount);
+
+		const VkPipelineRasterizationStateCreateInfo& rasterization = pipeline_builder.rasterizationInfo;
+		writer.add(rasterization.depthClampEnable);
+		writer.add(rasterization.rasterizerDiscardEnable);
+		writer.add(rasterization.polygonMode);
+		writer.add(rasterization.cullMode);
+		writer.add(rasterization.frontFace);
+		writer.add(rasterization.depthBiasEnable);
+		writer.add(rasterization.depthBiasConstantFactor);
+		writer.add(rasterization.depthBiasClamp);
+		writer.add(rasterization.depthBiasSlopeFactor);
+		writer.add(rasterization.lineWidth);
+
+		const VkPipelineMultisampleStateCreateInfo& multisample = pipeline_builder.multisampleInfo;
+		writer.add(multisample.rasterizationSamples);
+		writer.add(multisample.sampleShadingEnable);
+		writer.add(multisample.minSampleShading);
+		writer.add(multisample.alphaToCoverageEnable);
+		writer.add(multisample.alphaToOneEnable);
+
+		const VkPipelineColorBlendStateCreateInfo& color_blend = pipeline_builder.colorBlendInfo;
+		writer.add(color_blend.logicOpEnable);
+		writer.add(color_blend.logicOp);
+		for (float constant : color_blend.blendConstants)
+			writer.add(constant);
+		writer.add(color_blend.attachmentCount);
+		for (uint32_t i = 0; i < color_blend.attachmentCount; i++)
+		{
+			const VkPipelineColorBlendAttachmentState& attachment = color_blend.pAttachments[i];
+			writer.add(attachment.blendEnable);
+			writer.add(attachment.srcColorBlendFactor);
+			writer.add(attachment.dstColorBlendFactor);
+			writer.add(attachment.colorBlendOp);
+			writer.add(attachment.srcAlphaBlendFactor);
+			writer.add(attachment.dstAlphaBlendFactor);
+			writer.add(attachment.alphaBlendOp);
+			writer.add(attachment.colorWriteMask);
+		}
+
+		const VkPipelineDepthStencilStateCreateInfo& depth_stencil = pipeline_builder.depthStencilInfo;
+		writer.add(depth_stencil.depthTestEnable);
+		writer.add(depth_stencil.depthWriteEnable);
+		writer.add(depth_stencil.depthCompareOp);
+		writer.add(depth_stencil.depthBoundsTestEnable);
+		writer.add(depth_stencil.stencilTestEnable);
+		writer.add(depth_stencil.front);
+		writer.add(depth_stencil.back);
+		writer.add(depth_stencil.minDepthBounds);
+		writer.add(depth_stencil.maxDepthBounds);
+
+		writer.add(pipeline_builder.dynamicStates.size());
+		for (VkDynamicState state : pipeline_builder.dynamicStates)
+			writer.add(state);
+
+		writer.add(pipeline_builder.bindingDescriptions.size());
+		for (const VkVertexInputBindingDescription& binding : pipeline_builder.bindingDescriptions)
+		{
+			writer.add(binding.binding);
+			writer.add(binding.stride);
+			writer.add(binding.inputRate);
+		}
+
+		writer.add(pipeline_builder.attributeDescriptions.size());
+		for (const VkVertexInputAttributeDescription& attribute : pipeline_builder.attributeDescriptions)
+		{
+			writer.add(attribute.location);
+			writer.add(attribute.binding);
+			writer.add(attribute.format);
+			writer.add(attribute.offset);
+		}
+
+		writer.add(pipeline_builder.pipelineLayout);
+		writer.add(pipeline_builder.renderPass);
+		writer.add(pipeline_builder.subpass);
+		writer.add(pipeline_builder.colorAttachmentFormats.size());
+		for (VkFormat format : pipeline_builder.colorAttachmentFormats)
+			writer.add(format);
+		writer.add(pipeline_builder.depthAttachmentFormat);
+
+		// every set of constant values is a variant of its own
+		writer.add(pipeline_builder.vertexConstants);
+		writer.add(pipeline_builder.fragmentConstants);
+
+		return writer.take();
+	}
+
+}
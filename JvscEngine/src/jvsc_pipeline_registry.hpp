@@ -0,0 +1,97 @@
+#pragma once
+
+// lib
+#include "jvsc_job_system.hpp"
+#include "jvsc_pipeline.hpp"
+
+// std
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace jvsc {
+
+	// A pipeline handed out by JvscPipelineRegistry, owned by the registry and shared by every
+	// request with the same state. Compiles on the job system, get() is null until it is done.
+	class SharedPipeline
+	{
+	public:
+
+		SharedPipeline() = default;
+		SharedPipeline(const SharedPipeline&) = delete;
+		SharedPipeline& operator=(const SharedPipeline&) = delete;
+
+		JvscPipeline* get() const { return m_pipeline.load(std::memory_order_acquire); }
+		bool ready() const { return get() != nullptr; }
+		// the compile threw, get() stays null
+		bool failed() const { return m_failed.load(std::memory_order_acquire); }
+		const std::string& name() const { return m_name; }
+
+	private:
+
+		friend class JvscPipelineRegistry;
+
+		std::atomic<JvscPipeline*> m_pipeline{ nullptr };
+		std::atomic<bool> m_failed{ false };
+		JobCounter m_compiling;
+		VkPipelineLayout m_layout = VK_NULL_HANDLE;
+		std::string m_name;
+		// everything the registry keys on, compared on a hash match
+		std::string m_state;
+		// the requester's builder copied for the compile job, released by the job
+		std::unique_ptr<PipelineBuilder> m_builder;
+	};
+
+	// Owns the graphics pipelines of the render systems. Requests are keyed by the full pipeline state
+	// (shader modules, builder fields, vertex format, layout, attachments and specialization constants),
+	// found by its hash and compared in full, so only equal requests share one VkPipeline. A state seen
+	// for the first time is compiled on a worker through the renderer's pipeline cache; callers draw
+	// with a fallback or skip their draws until it is ready(), a compile never stalls a frame.
+	class JvscPipelineRegistry
+	{
+	public:
+
+		JvscPipelineRegistry(JvscRenderer& renderer);
+		~JvscPipelineRegistry() = default;
+		// waits for compiles still running, the pipelines are destroyed once the device is done with them
+		void terminate();
+
+		JvscPipelineRegistry(const JvscPipelineRegistry&) = delete;
+		JvscPipelineRegistry& operator=(const JvscPipelineRegistry&) = delete;
+
+		// Render thread only, shader modules are loaded on the calling thread. The builder is copied;
+		// pointers it holds other than colorBlendInfo.pAttachments must stay valid until ready().
+		SharedPipeline& request(const std::string& vertex_filepath, const std::string& fragment_filepath, const PipelineBuilder& pipeline_builder);
+
+		// blocks until the pipeline is compiled, running other jobs meanwhile, throws if the compile failed
+		JvscPipeline& wait(SharedPipeline& pipeline);
+		void wait_all();
+
+		// Call before destroying layout: waits for its compiles and retires the pipelines built with it
+		// through JvscRenderer::defer_destruction(). A new layout may get the same handle, which must not
+		// match these. Their SharedPipeline objects are gone once this returns.
+		void release_layout(VkPipelineLayout layout);
+
+		size_t pipeline_count() const { return m_pipeline_count; }
+		// requested and not compiled yet
+		size_t pending_count() const;
+		// requests answered with a pipeline that already existed
+		uint64_t shared_count() const { return m_shared_requests; }
+
+	private:
+
+		static std::string serialize_state(VkShaderModule vertex_module, VkShaderModule fragment_module, const PipelineBuilder& pipeline_builder);
+
+		void retire(SharedPipeline& pipeline);
+
+		JvscRenderer& m_renderer;
+
+		// by state hash, more than one pipeline per hash only on a collision
+		std::unordered_map<uint64_t, std::vector<std::unique_ptr<SharedPipeline>>> m_pipelines;
+		size_t m_pipeline_count = 0;
+		uint64_t m_shared_requests = 0;
+	};
+
+}
@@ -0,0 +1,229 @@
+#include "jvsc_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace jvsc {
+
+	// Single producer, single consumer: the owning thread advances head, collect() advances tail.
+	struct JvscProfiler::ThreadBuffer
+	{
+		std::vector<ProfileEvent> events;
+		size_t mask;
+		alignas(64) std::atomic<uint64_t> head{ 0 };
+		alignas(64) std::atomic<uint64_t> tail{ 0 };
+		std::atomic<uint64_t> dropped{ 0 };
+		uint32_t thread;
+		std::string name;
+	};
+
+	JvscProfiler* JvscProfiler::s_instance = nullptr;
+	std::atomic<bool> JvscProfiler::s_enabled{ false };
+
+	// which profiler the calling thread's buffer belongs to, a new profiler hands out new buffers
+	static uint64_t s_generation = 0;
+	static thread_local uint64_t t_generation = 0;
+	static thread_local void* t_buffer = nullptr;
+
+	JvscProfiler& JvscProfiler::create(size_t ring_capacity, size_t max_events)
+	{
+		if (!JvscProfiler::s_instance)
+			JvscProfiler::s_instance = new JvscProfiler(ring_capacity, max_events);
+		else
+			throw std::runtime_error("only 1 profiler per application");
+		return *JvscProfiler::s_instance;
+	}
+
+	JvscProfiler& JvscProfiler::get()
+	{
+		if (!JvscProfiler::s_instance)
+			throw std::runtime_error("the profiler wasn't initialized before get");
+		return *JvscProfiler::s_instance;
+	}
+
+	JvscProfiler::JvscProfiler(size_t ring_capacity, size_t max_events)
+		: m_max_events{max_events}
+	{
+		std::cout << "calling profiler constructor" << '\n';
+
+		m_ring_capacity = 1;
+		while (m_ring_capacity < ring_capacity)
+			m_ring_capacity <<= 1;
+
+		s_generation++;
+	}
+
+	JvscProfiler::~JvscProfiler() = default;
+
+	void JvscProfiler::terminate()
+	{
+		std::cout << "calling profiler destructor" << '\n';
+
+		s_enabled = false;
+		delete s_instance;
+		s_instance = nullptr;
+	}
+
+	uint64_t JvscProfiler::now_ns()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	void JvscProfiler::record(const char* name, uint64_t start_ns, uint64_t end_ns)
+	{
+		if (!s_instance)
+			return;
+
+		ThreadBuffer& buffer = s_instance->thread_buffer();
+
+		uint64_t head = buffer.head.load(std::memory_order_relaxed);
+		if (head - buffer.tail.load(std::memory_order_acquire) > buffer.mask)
+		{
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		buffer.events[head & buffer.mask] = ProfileEvent{ name, start_ns, end_ns - start_ns, buffer.thread };
+		buffer.head.store(head + 1, std::memory_order_release);
+	}
+
+	JvscProfiler::ThreadBuffer& JvscProfiler::thread_buffer()
+	{
+		if (t_generation == s_generation && t_buffer)
+			return *static_cast<ThreadBuffer*>(t_buffer);
+
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->events.resize(m_ring_capacity);
+		buffer->mask = m_ring_capacity - 1;
+
+		std::lock_guard<std::mutex> lock(m_buffers_mutex);
+		buffer->thread = static_cast<uint32_t>(m_buffers.size());
+		buffer->name = "thread " + std::to_string(buffer->thread);
+
+		t_buffer = buffer.get();
+		t_generation = s_generation;
+		m_buffers.push_back(std::move(buffer));
+		return *m_buffers.back();
+	}
+
+	void JvscProfiler::set_thread_name(const std::string& name)
+	{
+		ThreadBuffer& buffer = thread_buffer();
+		std::lock_guard<std::mutex> lock(m_buffers_mutex);
+		buffer.name = name;
+	}
+
+	void JvscProfiler::record_gpu(const char* name, uint64_t start_ns, uint64_t duration_ns)
+	{
+		if (m_events.size() >= m_max_events)
+		{
+			m_dropped++;
+			return;
+		}
+		m_events.push_back(ProfileEvent{ name, start_ns, duration_ns, GPU_THREAD });
+	}
+
+	void JvscProfiler::collect()
+	{
+		std::lock_guard<std::mutex> lock(m_buffers_mutex);
+		for (auto& buffer : m_buffers)
+		{
+			uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+			uint64_t head = buffer->head.load(std::memory_order_acquire);
+			for (; tail < head; tail++)
+			{
+				if (m_events.size() < m_max_events)
+					m_events.push_back(buffer->events[tail & buffer->mask]);
+				else
+					m_dropped++;
+			}
+			// hands the slots back to the owning thread
+			buffer->tail.store(head, std::memory_order_release);
+		}
+	}
+
+	void JvscProfiler::clear()
+	{
+		collect();
+		m_events.clear();
+		m_dropped = 0;
+
+		std::lock_guard<std::mutex> lock(m_buffers_mutex);
+		for (auto& buffer : m_buffers)
+			buffer->dropped = 0;
+	}
+
+	size_t JvscProfiler::dropped_count() const
+	{
+		size_t dropped = m_dropped;
+		std::lock_guard<std::mutex> lock(m_buffers_mutex);
+		for (const auto& buffer : m_buffers)
+			dropped += buffer->dropped.load(std::memory_order_relaxed);
+		return dropped;
+	}
+
+	static void write_json_string(std::ostream& out, const char* text)
+	{
+		out << '"';
+		for (const char* c = text; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				out << '\\' << *c;
+			else if (static_cast<unsigned char>(*c) < 0x20)
+				out << ' ';
+			else
+				out << *c;
+		}
+		out << '"';
+	}
+
+	void JvscProfiler::write_chrome_trace(const std::string& path)
+	{
+		collect();
+
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open())
+			throw std::runtime_error("failed to open trace file: " + path);
+
+		// the trace starts at the first event, timestamps are in microseconds
+		uint64_t origin = UINT64_MAX;
+		for (const ProfileEvent& event : m_events)
+			origin = std::min(origin, event.start_ns);
+		if (m_events.empty())
+			origin = 0;
+
+		// CPU threads under process 1, the GPU as its own process 2
+		file << "{\"traceEvents\":[\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+		file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+		{
+			std::lock_guard<std::mutex> lock(m_buffers_mutex);
+			for (const auto& buffer : m_buffers)
+			{
+				file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread << ",\"args\":{\"name\":";
+				write_json_string(file, buffer->name.c_str());
+				file << "}}";
+			}
+		}
+
+		file << std::fixed << std::setprecision(3);
+		for (const ProfileEvent& event : m_events)
+		{
+			bool gpu = event.thread == GPU_THREAD;
+			file << ",\n{\"name\":";
+			write_json_string(file, event.name);
+			file << ",\"ph\":\"X\",\"ts\":" << static_cast<double>(event.start_ns - origin) / 1000.0
+				<< ",\"dur\":" << static_cast<double>(event.duration_ns) / 1000.0
+				<< ",\"pid\":" << (gpu ? 2 : 1) << ",\"tid\":" << (gpu ? 0 : event.thread) << "}";
+		}
+		file << "\n]}\n";
+
+		std::cout << "wrote " << m_events.size() << " profile events to " << path << " (" << dropped_count() << " dropped)" << '\n';
+	}
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace jvsc {
+
+	// one finished scope, times in steady clock nanoseconds
+	struct ProfileEvent
+	{
+		// must outlive the profiler, scopes take string literals
+		const char* name;
+		uint64_t start_ns;
+		uint64_t duration_ns;
+		uint32_t thread;
+	};
+
+	// Collects CPU scopes from any thread and GPU scopes from JvscRenderer, exports them as a
+	// Chrome trace (chrome://tracing, ui.perfetto.dev). Each thread appends to its own fixed-size
+	// ring without locking, collect() drains the rings into one list from the render thread. A
+	// full ring drops new events instead of blocking. Disabled, a scope costs one relaxed load.
+	class JvscProfiler
+	{
+	public:
+
+		static constexpr size_t DEFAULT_RING_CAPACITY = 1 << 14;
+		static constexpr size_t DEFAULT_MAX_EVENTS = 1 << 20;
+		// thread id of the events read back from GPU timestamps
+		static constexpr uint32_t GPU_THREAD = UINT32_MAX;
+
+		// ring_capacity is per thread and rounded up to a power of two, max_events bounds the collected list
+		static JvscProfiler& create(size_t ring_capacity = DEFAULT_RING_CAPACITY, size_t max_events = DEFAULT_MAX_EVENTS);
+
+		static JvscProfiler& get();
+
+		// no thread may be inside a scope anymore
+		void terminate();
+
+		static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+		void set_enabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+
+		static uint64_t now_ns();
+
+		// CPU event on the calling thread's ring, called by ProfileScope
+		static void record(const char* name, uint64_t start_ns, uint64_t end_ns);
+
+		// names the calling thread in the trace, threads are "thread N" otherwise
+		void set_thread_name(const std::string& name);
+
+		// GPU event already converted to the CPU clock, render thread only
+		void record_gpu(const char* name, uint64_t start_ns, uint64_t duration_ns);
+
+		// moves everything the rings hold into the collected list, once per frame keeps them from filling up
+		void collect();
+
+		// collects, then writes every collected event as Chrome trace JSON
+		void write_chrome_trace(const std::string& path);
+
+		void clear();
+
+		// collected so far, render thread only
+		const std::vector<ProfileEvent>& events() const { return m_events; }
+		size_t event_count() const { return m_events.size(); }
+		// events lost to full rings or to max_events
+		size_t dropped_count() const;
+
+	private:
+
+		struct ThreadBuffer;
+
+		JvscProfiler(size_t ring_capacity, size_t max_events);
+		~JvscProfiler();
+		JvscProfiler(const JvscProfiler&) = delete;
+		JvscProfiler& operator=(const JvscProfiler&) = delete;
+
+		static JvscProfiler* s_instance;
+		static std::atomic<bool> s_enabled;
+
+		ThreadBuffer& thread_buffer();
+
+		size_t m_ring_capacity;
+		size_t m_max_events;
+
+		// buffers outlive their threads, registration is the only locked part of recording
+		mutable std::mutex m_buffers_mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+
+		std::vector<ProfileEvent> m_events;
+		size_t m_dropped = 0;
+	};
+
+	// times the enclosing block, see JVSC_PROFILE_SCOPE
+	class ProfileScope
+	{
+	public:
+
+		explicit ProfileScope(const char* name)
+			: m_name{name}
+			, m_active{JvscProfiler::enabled()}
+			, m_start{m_active ? JvscProfiler::now_ns() : 0}
+		{
+		}
+
+		~ProfileScope()
+		{
+			if (m_active)
+				JvscProfiler::record(m_name, m_start, JvscProfiler::now_ns());
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+
+	private:
+
+		const char* m_name;
+		bool m_active;
+		uint64_t m_start;
+	};
+
+}
+
+#define JVSC_PROFILE_CONCAT_INNER(a, b) a##b
+#define JVSC_PROFILE_CONCAT(a, b) JVSC_PROFILE_CONCAT_INNER(a, b)
+#define JVSC_PROFILE_SCOPE(name) ::jvsc::ProfileScope JVSC_PROFILE_CONCAT(jvsc_profile_scope_, __LINE__){ name }
@@ -0,0 +1,335 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace jvsc {
+
+	// slot index in the low 24 bits, generation in the high 8 so handles to destroyed entities go stale
+	using Entity = uint32_t;
+	constexpr Entity NULL_ENTITY = ~0u;
+
+	constexpr uint32_t ENTITY_INDEX_BITS = 24;
+	constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+
+	inline uint32_t entity_index(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+	inline uint32_t entity_generation(Entity entity) { return entity >> ENTITY_INDEX_BITS; }
+
+	// Sparse set: m_sparse maps an entity's slot index to its position in the dense arrays,
+	// which stay tightly packed because removal swaps the last entry into the hole.
+	class ComponentPoolBase
+	{
+	public:
+
+		virtual ~ComponentPoolBase() = default;
+
+		virtual void remove(Entity entity) = 0;
+
+		bool contains(Entity entity) const
+		{
+			uint32_t index = entity_index(entity);
+			return index < m_sparse.size() && m_sparse[index] != NOT_PRESENT && m_entities[m_sparse[index]] == entity;
+		}
+
+		// position in the dense arrays, entity must be present
+		size_t index_of(Entity entity) const { return m_sparse[entity_index(entity)]; }
+
+		size_t size() const { return m_entities.size(); }
+		bool empty() const { return m_entities.empty(); }
+		Entity entity_at(size_t index) const { return m_entities[index]; }
+		const Entity* entities() const { return m_entities.data(); }
+
+		// Opt-in list of the entities whose component was added, removed or marked changed, for the one
+		// system mirroring this pool elsewhere, which clears it once consumed. Entries may repeat and may
+		// name entities that no longer have the component. Turning it on lists every present entity.
+		void track_changes()
+		{
+			if (m_tracking)
+				return;
+			m_tracking = true;
+			m_changed.insert(m_changed.end(), m_entities.begin(), m_entities.end());
+		}
+
+		bool tracks_changes() const { return m_tracking; }
+		void mark_changed(size_t index) { record_change(m_entities[index]); }
+		const std::vector<Entity>& changed() const { return m_changed; }
+		void clear_changes() { m_changed.clear(); }
+
+	protected:
+
+		static constexpr uint32_t NOT_PRESENT = ~0u;
+
+		void record_change(Entity entity)
+		{
+			if (m_tracking)
+				m_changed.push_back(entity);
+		}
+
+		std::vector<uint32_t> m_sparse;
+		std::vector<Entity> m_entities;
+
+		bool m_tracking = false;
+		std::vector<Entity> m_changed;
+	};
+
+	template<typename T>
+	class ComponentPool : public ComponentPoolBase
+	{
+	public:
+
+		template<typename... Args>
+		T& emplace(Entity entity, Args&&... args)
+		{
+			if (contains(entity))
+				throw std::runtime_error("entity already has this component");
+
+			uint32_t index = entity_index(entity);
+			if (index >= m_sparse.size())
+				m_sparse.resize(static_cast<size_t>(index) + 1, NOT_PRESENT);
+
+			m_sparse[index] = static_cast<uint32_t>(m_entities.size());
+			m_entities.push_back(entity);
+			m_components.push_back(T{ std::forward<Args>(args)... });
+			record_change(entity);
+			return m_components.back();
+		}
+
+		void remove(Entity entity) override
+		{
+			if (!contains(entity))
+				return;
+
+			record_change(entity);
+			swap_entries(index_of(entity), m_entities.size() - 1);
+			m_sparse[entity_index(entity)] = NOT_PRESENT;
+			m_entities.pop_back();
+			m_components.pop_back();
+		}
+
+		T& get(Entity entity) { return m_components[index_of(entity)]; }
+		const T& get(Entity entity) const { return m_components[index_of(entity)]; }
+
+		T* try_get(Entity entity) { return contains(entity) ? &m_components[index_of(entity)] : nullptr; }
+
+		// get() for writing, lists the entity as changed
+		T& patch(Entity entity)
+		{
+			record_change(entity);
+			return get(entity);
+		}
+
+		// dense component array, parallel to entities()
+		T* data() { return m_components.data(); }
+		const T* data() const { return m_components.data(); }
+
+		T& operator[](size_t index) { return m_components[index]; }
+		const T& operator[](size_t index) const { return m_components[index]; }
+
+		void swap_entries(size_t a, size_t b)
+		{
+			if (a == b)
+				return;
+
+			std::swap(m_entities[a], m_entities[b]);
+			std::swap(m_components[a], m_components[b]);
+			m_sparse[entity_index(m_entities[a])] = static_cast<uint32_t>(a);
+			m_sparse[entity_index(m_entities[b])] = static_cast<uint32_t>(b);
+		}
+
+	private:
+
+		std::vector<T> m_components;
+	};
+
+	// Entity-component store. Every component type lives in its own ComponentPool, so a system
+	// touching transforms only streams transforms through the cache. pack() lines several pools
+	// up so that systems can walk them as plain parallel arrays.
+	class JvscRegistry
+	{
+	public:
+
+		JvscRegistry() = default;
+		~JvscRegistry() = default;
+
+		JvscRegistry(const JvscRegistry&) = delete;
+		JvscRegistry& operator=(const JvscRegistry&) = delete;
+
+		Entity create()
+		{
+			uint32_t index;
+			if (!m_free_indices.empty())
+			{
+				index = m_free_indices.back();
+				m_free_indices.pop_back();
+			}
+			else
+			{
+				if (m_slots.size() >= ENTITY_INDEX_MASK)
+					throw std::runtime_error("failed to create entity, out of entity slots");
+
+				index = static_cast<uint32_t>(m_slots.size());
+				m_slots.push_back(NULL_ENTITY);
+				m_generations.push_back(0);
+			}
+
+			Entity entity = (static_cast<uint32_t>(m_generations[index]) << ENTITY_INDEX_BITS) | index;
+			m_slots[index] = entity;
+			m_alive_count++;
+			return entity;
+		}
+
+		// invalidates pointers and indices into every pool the entity had components in
+		void destroy(Entity entity)
+		{
+			if (!alive(entity))
+				return;
+
+			for (auto& pool : m_pools)
+			{
+				if (pool)
+					pool->remove(entity);
+			}
+
+			uint32_t index = entity_index(entity);
+			m_slots[index] = NULL_ENTITY;
+			m_generations[index]++;
+			m_free_indices.push_back(index);
+			m_alive_count--;
+		}
+
+		bool alive(Entity entity) const
+		{
+			uint32_t index = entity_index(entity);
+			return entity != NULL_ENTITY && index < m_slots.size() && m_slots[index] == entity;
+		}
+
+		size_t entity_count() const { return m_alive_count; }
+
+		template<typename T, typename... Args>
+		T& add(Entity entity, Args&&... args)
+		{
+			if (!alive(entity))
+				throw std::runtime_error("failed to add component, entity is not alive");
+			return pool<T>().emplace(entity, std::forward<Args>(args)...);
+		}
+
+		template<typename T>
+		void remove(Entity entity) { pool<T>().remove(entity); }
+
+		template<typename T>
+		bool has(Entity entity) const
+		{
+			const ComponentPool<T>* component_pool = find_pool<T>();
+			return component_pool && component_pool->contains(entity);
+		}
+
+		template<typename T>
+		T& get(Entity entity) { return pool<T>().get(entity); }
+
+		template<typename T>
+		T* try_get(Entity entity) { return pool<T>().try_get(entity); }
+
+		// use instead of get() when changing a component whose pool tracks changes
+		template<typename T>
+		T& patch(Entity entity) { return pool<T>().patch(entity); }
+
+		template<typename T>
+		ComponentPool<T>& pool()
+		{
+			uint32_t id = component_id<T>();
+			if (id >= m_pools.size())
+				m_pools.resize(static_cast<size_t>(id) + 1);
+			if (!m_pools[id])
+				m_pools[id] = std::make_unique<ComponentPool<T>>();
+			return static_cast<ComponentPool<T>&>(*m_pools[id]);
+		}
+
+		// function(entity, T&, Others&...) for every entity having all the components. Pools that
+		// line up with T's (see pack) are read by index, the rest through their sparse arrays.
+		// Adding or removing components inside function is not allowed.
+		template<typename T, typename... Others, typename Function>
+		void each(Function&& function)
+		{
+			ComponentPool<T>& lead = pool<T>();
+			std::tuple<ComponentPool<Others>&...> others{ pool<Others>()... };
+
+			for (size_t i = 0; i < lead.size(); i++)
+			{
+				Entity entity = lead.entity_at(i);
+				bool has_all = std::apply([entity](auto&... other) { return (other.contains(entity) && ...); }, others);
+				if (!has_all)
+					continue;
+
+				std::apply([&](auto&... other) {
+					function(entity, lead[i], component_at(other, i, entity)...);
+				}, others);
+			}
+		}
+
+		// Moves every entity having all the components to the front of each pool, in the same
+		// order, and returns how many there are. Afterwards pool<X>()[i] for i < count all belong
+		// to the same entity. Cheap to call every frame, already packed entries are not moved.
+		template<typename T, typename... Others>
+		size_t pack()
+		{
+			ComponentPool<T>& lead = pool<T>();
+			std::tuple<ComponentPool<Others>&...> others{ pool<Others>()... };
+
+			size_t packed = 0;
+			for (size_t i = 0; i < lead.size(); i++)
+			{
+				Entity entity = lead.entity_at(i);
+				bool has_all = std::apply([entity](auto&... other) { return (other.contains(entity) && ...); }, others);
+				if (!has_all)
+					continue;
+
+				// everything in front of packed is already placed, so the entity can only sit at or after it
+				lead.swap_entries(i, packed);
+				std::apply([entity, packed](auto&... other) { (other.swap_entries(other.index_of(entity), packed), ...); }, others);
+				packed++;
+			}
+			return packed;
+		}
+
+	private:
+
+		template<typename T>
+		static T& component_at(ComponentPool<T>& component_pool, size_t index, Entity entity)
+		{
+			if (index < component_pool.size() && component_pool.entity_at(index) == entity)
+				return component_pool[index];
+			return component_pool.get(entity);
+		}
+
+		template<typename T>
+		const ComponentPool<T>* find_pool() const
+		{
+			uint32_t id = component_id<T>();
+			return id < m_pools.size() ? static_cast<const ComponentPool<T>*>(m_pools[id].get()) : nullptr;
+		}
+
+		// ids are handed out on first use and shared by every registry
+		template<typename T>
+		static uint32_t component_id()
+		{
+			static const uint32_t id = s_next_component_id++;
+			return id;
+		}
+
+		inline static uint32_t s_next_component_id = 0;
+
+		std::vector<std::unique_ptr<ComponentPoolBase>> m_pools;
+
+		// current handle per slot, NULL_ENTITY while the slot is free
+		std::vector<Entity> m_slots;
+		std::vector<uint8_t> m_generations;
+		std::vector<uint32_t> m_free_indices;
+		size_t m_alive_count = 0;
+	};
+
+}
@@ -0,0 +1,189 @@
+#include "jvsc_registry.hpp"
+
+// lib
+#include <gtest/gtest.h>
+
+// std
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace jvsc {
+
+	namespace {
+
+		struct Position
+		{
+			int x = 0;
+		};
+
+		struct Velocity
+		{
+			int dx = 0;
+		};
+
+	}
+
+	TEST(RegistryTest, DestroyedSlotComesBackWithNewGeneration)
+	{
+		JvscRegistry registry;
+		Entity first = registry.create();
+		Entity second = registry.create();
+		EXPECT_NE(entity_index(first), entity_index(second));
+
+		registry.destroy(first);
+		EXPECT_FALSE(registry.alive(first));
+		EXPECT_EQ(registry.entity_count(), 1u);
+
+		Entity reused = registry.create();
+		EXPECT_EQ(entity_index(reused), entity_index(first));
+		EXPECT_EQ(entity_generation(reused), entity_generation(first) + 1);
+		EXPECT_TRUE(registry.alive(reused));
+		EXPECT_FALSE(registry.alive(first));
+		EXPECT_FALSE(registry.alive(NULL_ENTITY));
+	}
+
+	TEST(RegistryTest, StaleHandleDoesNotSeeNewComponents)
+	{
+		JvscRegistry registry;
+		Entity first = registry.create();
+		registry.add<Position>(first, 1);
+		registry.destroy(first);
+
+		Entity reused = registry.create();
+		registry.add<Position>(reused, 2);
+		EXPECT_TRUE(registry.has<Position>(reused));
+		EXPECT_FALSE(registry.has<Position>(first));
+		EXPECT_THROW(registry.add<Position>(first, 3), std::runtime_error);
+	}
+
+	TEST(RegistryTest, RemoveKeepsPoolDense)
+	{
+		JvscRegistry registry;
+		std::vector<Entity> entities;
+		for (int i = 0; i < 5; i++)
+		{
+			entities.push_back(registry.create());
+			registry.add<Position>(entities.back(), i * 10);
+		}
+
+		registry.remove<Position>(entities[1]);
+		registry.remove<Position>(entities[1]);
+		registry.destroy(entities[3]);
+
+		ComponentPool<Position>& positions = registry.pool<Position>();
+		EXPECT_EQ(positions.size(), 3u);
+		EXPECT_FALSE(registry.has<Position>(entities[1]));
+		EXPECT_FALSE(registry.has<Position>(entities[3]));
+		for (int i : { 0, 2, 4 })
+		{
+			ASSERT_TRUE(registry.has<Position>(entities[i]));
+			EXPECT_EQ(registry.get<Position>(entities[i]).x, i * 10);
+			EXPECT_EQ(positions.entity_at(positions.index_of(entities[i])), entities[i]);
+		}
+	}
+
+	TEST(RegistryTest, AddingTwiceThrows)
+	{
+		JvscRegistry registry;
+		Entity entity = registry.create();
+		registry.add<Position>(entity);
+		EXPECT_THROW(registry.add<Position>(entity), std::runtime_error);
+	}
+
+	TEST(RegistryTest, PackLinesPoolsUp)
+	{
+		JvscRegistry registry;
+		std::vector<Entity> both;
+		for (int i = 0; i < 20; i++)
+		{
+			Entity entity = registry.create();
+			// every third entity has only a velocity, every fifth only a position
+			if (i % 3 != 0)
+				registry.add<Position>(entity, i);
+			if (i % 5 != 0)
+				registry.add<Velocity>(entity, -i);
+			if (i % 3 != 0 && i % 5 != 0)
+				both.push_back(entity);
+		}
+
+		size_t count = registry.pack<Position, Velocity>();
+		ASSERT_EQ(count, both.size());
+
+		ComponentPool<Position>& positions = registry.pool<Position>();
+		ComponentPool<Velocity>& velocities = registry.pool<Velocity>();
+		std::vector<Entity> packed;
+		for (size_t i = 0; i < count; i++)
+		{
+			ASSERT_EQ(positions.entity_at(i), velocities.entity_at(i));
+			EXPECT_EQ(positions[i].x, -velocities[i].dx);
+			packed.push_back(positions.entity_at(i));
+		}
+		std::sort(packed.begin(), packed.end());
+		EXPECT_EQ(packed, both);
+
+		// already packed, a second call moves nothing
+		std::vector<Entity> before(positions.entities(), positions.entities() + positions.size());
+		EXPECT_EQ((registry.pack<Position, Velocity>()), count);
+		EXPECT_TRUE(std::equal(before.begin(), before.end(), positions.entities()));
+	}
+
+	TEST(RegistryTest, EachVisitsEntitiesWithAllComponents)
+	{
+		JvscRegistry registry;
+		std::vector<Entity> entities;
+		std::vector<Entity> both;
+		for (int i = 0; i < 10; i++)
+		{
+			Entity entity = registry.create();
+			entities.push_back(entity);
+			registry.add<Position>(entity, i);
+			if (i % 2 == 0)
+			{
+				registry.add<Velocity>(entity, 1);
+				both.push_back(entity);
+			}
+		}
+
+		std::vector<Entity> visited;
+		registry.each<Position, Velocity>([&](Entity entity, Position& position, Velocity& velocity)
+		{
+			position.x += velocity.dx;
+			visited.push_back(entity);
+		});
+
+		std::sort(visited.begin(), visited.end());
+		EXPECT_EQ(visited, both);
+		for (int i = 0; i < 10; i++)
+			EXPECT_EQ(registry.get<Position>(entities[i]).x, i % 2 == 0 ? i + 1 : i);
+	}
+
+	TEST(RegistryTest, ChangeListRecordsAddPatchAndRemove)
+	{
+		JvscRegistry registry;
+		Entity before = registry.create();
+		registry.add<Position>(before);
+
+		ComponentPool<Position>& positions = registry.pool<Position>();
+		EXPECT_TRUE(positions.changed().empty());
+
+		// turning tracking on lists what is already there
+		positions.track_changes();
+		EXPECT_EQ(positions.changed(), std::vector<Entity>{ before });
+		positions.clear_changes();
+
+		Entity added = registry.create();
+		registry.add<Position>(added);
+		registry.patch<Position>(before).x = 5;
+		registry.get<Position>(added).x = 6;
+		registry.destroy(added);
+
+		EXPECT_EQ(positions.changed(), (std::vector<Entity>{ added, before, added }));
+		EXPECT_EQ(registry.get<Position>(before).x, 5);
+
+		positions.clear_changes();
+		positions.mark_changed(positions.index_of(before));
+		EXPECT_EQ(positions.changed(), std::vector<Entity>{ before });
+	}
+
+}
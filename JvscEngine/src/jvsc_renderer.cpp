@@ -1,4 +1,9 @@
 #include "jvsc_renderer.hpp"
+#include "jvsc_uploader.hpp"
+#include "jvsc_mesh_pool.hpp"
+#include "jvsc_shader_registry.hpp"
+#include "jvsc_pipeline_registry.hpp"
+#include "jvsc_mesh.hpp"
 
 // lib
 #define VMA_IMPLEMENTATION
@@ -7,6 +12,10 @@
 
 // std
 #include <unordered_set>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <set>
 #include <stdexcept>
 #include <iostream>
@@ -30,8 +39,32 @@ namespace jvsc {
 		}
 	}
 
-	JvscRenderer::JvscRenderer(JvscWindow& window)
-		: m_window{window}
+	static bool has_extension(const std::vector<VkExtensionProperties>& extensions, const char* name)
+	{
+		return std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& extension) {
+			return strcmp(extension.extensionName, name) == 0;
+		});
+	}
+
+	static bool has_stencil_component(VkFormat format)
+	{
+		return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+	}
+
+	// a blocking present wait gives up after this, a present that never completes must not hang the frame
+	static constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000;
+
+	JvscRenderer::JvscRenderer(JvscWindow& window, const RendererConfig& config)
+		: m_window{&window}
+		, m_max_frames_in_flight{ std::max(config.max_frames_in_flight, 1u) }
+		, m_pipeline_cache_path{ config.pipeline_cache_path }
+		, m_requested_present_mode{ config.present_mode }
+		, m_depth_bits{ config.depth_bits }
+		, m_timeline_semaphores_allowed{ config.timeline_semaphores }
+		, m_dynamic_rendering_allowed{ config.dynamic_rendering }
+		, m_extended_dynamic_state_allowed{ config.extended_dynamic_state }
+		, m_frame_pacer{ config.max_fps }
+		, m_low_latency{ config.low_latency }
 	{
 		std::cout << "calling renderer constructor" << '\n';
 
@@ -40,6 +73,7 @@ namespace jvsc {
 		select_physical_device();
 		create_device();
 		create_allocator();
+		create_pipeline_cache();
 		create_swapchain();
 		create_swapchain_image_views();
 		create_depth_resources();
@@ -48,27 +82,113 @@ namespace jvsc {
 		create_sync_objects();
 		create_command_pool();
 		create_command_buffers();
+		create_timestamp_queries();
+
+		m_uploader = new JvscUploader(*this);
+		m_mesh_pool = new JvscMeshPool(*this, sizeof(Vertex));
+		m_shader_registry = new JvscShaderRegistry(*this);
+		m_pipeline_registry = new JvscPipelineRegistry(*this);
+	}
+
+	JvscRenderer::JvscRenderer(VkExtent2D headless_extent, const RendererConfig& config)
+		: m_headless{true}
+		, m_max_frames_in_flight{ std::max(config.max_frames_in_flight, 1u) }
+		, m_pipeline_cache_path{ config.pipeline_cache_path }
+		, m_requested_present_mode{ config.present_mode }
+		, m_depth_bits{ config.depth_bits }
+		, m_timeline_semaphores_allowed{ config.timeline_semaphores }
+		, m_dynamic_rendering_allowed{ config.dynamic_rendering }
+		, m_extended_dynamic_state_allowed{ config.extended_dynamic_state }
+		, m_frame_pacer{ config.max_fps }
+		, m_low_latency{ config.low_latency }
+	{
+		std::cout << "calling headless renderer constructor" << '\n';
+
+		m_swapchain_extent = headless_extent;
+		device_extensions.clear();
+
+		create_instance();
+		select_physical_device();
+		create_device();
+		create_allocator();
+		create_pipeline_cache();
+		create_offscreen_images();
+		create_swapchain_image_views();
+		create_depth_resources();
+		create_render_pass();
+		create_framebuffers();
+		create_sync_objects();
+		create_command_pool();
+		create_command_buffers();
+		create_timestamp_queries();
+
+		m_uploader = new JvscUploader(*this);
+		m_mesh_pool = new JvscMeshPool(*this, sizeof(Vertex));
+		m_shader_registry = new JvscShaderRegistry(*this);
+		m_pipeline_registry = new JvscPipelineRegistry(*this);
 	}
 
 	void JvscRenderer::terminate()
 	{
 		std::cout << "calling renderer destructor" << '\n';
 
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+		// the uploader drains its pending copies into the pool buffers before they are destroyed
+		m_uploader->terminate();
+		delete m_uploader;
+		m_uploader = nullptr;
+
+		// compiles still running use shader modules, the pipelines themselves go with the deferred destructions
+		m_pipeline_registry->terminate();
+		delete m_pipeline_registry;
+		m_pipeline_registry = nullptr;
+
+		m_shader_registry->terminate();
+		delete m_shader_registry;
+		m_shader_registry = nullptr;
+
+		save_pipeline_cache();
+		vkDestroyPipelineCache(m_device, m_pipeline_cache, nullptr);
+
+		vkDeviceWaitIdle(m_device);
+		run_deferred_destructions(true);
+
+		// after the deferred destructions, meshes destroyed late free their ranges through them
+		m_mesh_pool->terminate();
+		delete m_mesh_pool;
+		m_mesh_pool = nullptr;
+
+		for (size_t i = 0; i < m_max_frames_in_flight; i++)
 		{
 			vkDestroySemaphore(m_device, m_render_finished_semaphores[i], nullptr);
 			vkDestroySemaphore(m_device, m_image_available_semaphores[i], nullptr);
-			vkDestroyFence(m_device, m_in_flight_fences[i], nullptr);
 		}
 
-		for (size_t i = 0; i < m_swapchain_images.size(); i++)
+		// the device is idle, this moves every pending fence to the free list
+		completed_gpu_value();
+		if (m_timeline_semaphore != VK_NULL_HANDLE)
+			vkDestroySemaphore(m_device, m_timeline_semaphore, nullptr);
+		for (VkFence fence : m_free_fences)
+			vkDestroyFence(m_device, fence, nullptr);
+		m_free_fences.clear();
+
+		for (VkFramebuffer framebuffer : m_swapchain_framebuffers)
+			vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+
+		for (size_t i = 0; i < m_depth_images.size(); i++)
 		{
-			vkDestroyFramebuffer(m_device, m_swapchain_framebuffers[i], nullptr);
 			vkDestroyImageView(m_device, m_depth_image_views[i], nullptr);
-			vkDestroyImageView(m_device, m_swapchain_image_views[i], nullptr);
 			vmaDestroyImage(m_allocator, m_depth_images[i], m_depth_image_allocations[i]);
 		}
+
+		for (size_t i = 0; i < m_swapchain_images.size(); i++)
+		{
+			vkDestroyImageView(m_device, m_swapchain_image_views[i], nullptr);
+
+			if (m_headless)
+				vmaDestroyImage(m_allocator, m_swapchain_images[i], m_offscreen_image_allocations[i]);
+		}
 		
+		m_offscreen_image_allocations.clear();
 		m_depth_image_allocations.clear();
 		m_swapchain_framebuffers.clear();
 		m_depth_image_views.clear();
@@ -77,9 +197,17 @@ namespace jvsc {
 		m_depth_images.clear();
 
 		vkDestroyRenderPass(m_device, m_render_pass, nullptr);
-		vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+		if (!m_headless)
+			vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
+
+		for (VkQueryPool pool : m_timestamp_pools)
+			vkDestroyQueryPool(m_device, pool, nullptr);
+		m_timestamp_pools.clear();
 
-		vkFreeCommandBuffers(m_device, m_command_pool, m_command_buffers.size(), m_command_buffers.data());
+		// destroying a pool frees the command buffers allocated from it
+		for (VkCommandPool pool : m_frame_command_pools)
+			vkDestroyCommandPool(m_device, pool, nullptr);
+		m_frame_command_pools.clear();
 		m_command_buffers.clear();
 
 		vkDestroyCommandPool(m_device, m_command_pool, nullptr);
@@ -88,36 +216,47 @@ namespace jvsc {
 
 		// if (enable_validation_layers) { destroy_debug_utils_messenger(m_instance, m_debug_messenger, nullptr); }
 
-		vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+		if (!m_headless)
+			vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
 		vkDestroyInstance(m_instance, nullptr);
 	}
 
 	VkResult JvscRenderer::submit_command_buffers(uint32_t* image_index)
 	{
-		if (m_images_in_flight[*image_index] != VK_NULL_HANDLE)
-			vkWaitForFences(m_device, 1, &m_images_in_flight[*image_index], VK_TRUE, UINT64_MAX);
-		
-		m_images_in_flight[*image_index] = m_in_flight_fences[m_current_frame];
+		// an image acquired out of slot order may still be rendered to by another slot's frame, this
+		// usually finds its value already reached by the wait in begin_frame() and does not block
+		wait_for_gpu_value(m_image_values[*image_index]);
 
 		VkSubmitInfo submit_info = {};
 		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+		// headless frames have no swapchain image to acquire or present, so there is nothing to wait on or signal
 		VkSemaphore wait_semaphores[] = { m_image_available_semaphores[m_current_frame] };
 		VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submit_info.waitSemaphoreCount = 1;
+		submit_info.waitSemaphoreCount = m_headless ? 0 : 1;
 		submit_info.pWaitSemaphores = wait_semaphores;
 		submit_info.pWaitDstStageMask = wait_stages;
 
 		submit_info.commandBufferCount = 1;
-		submit_info.pCommandBuffers = &m_command_buffers[*image_index];
+		submit_info.pCommandBuffers = &m_command_buffers[m_current_frame];
 
 		VkSemaphore signal_semaphores[] = { m_render_finished_semaphores[m_current_frame] };
-		submit_info.signalSemaphoreCount = 1;
+		submit_info.signalSemaphoreCount = m_headless ? 0 : 1;
 		submit_info.pSignalSemaphores = signal_semaphores;
 
-		vkResetFences(m_device, 1, &m_in_flight_fences[m_current_frame]);
-		if (vkQueueSubmit(m_graphics_queue, 1, &submit_info, m_in_flight_fences[m_current_frame]) != VK_SUCCESS)
-			throw std::runtime_error("failed to submit draw command buffer!");
+		uint64_t value = submit(submit_info);
+		m_frame_values[m_current_frame] = value;
+		m_image_values[*image_index] = value;
+
+		m_last_image_index = *image_index;
+		m_frame_ids[m_current_frame] = ++m_frame_counter;
+		m_frame_pacer.begin_tracking(m_frame_counter, m_frame_input_ns);
+
+		if (m_headless)
+		{
+			m_current_frame = (m_current_frame + 1) % m_max_frames_in_flight;
+			return VK_SUCCESS;
+		}
 
 		VkPresentInfoKHR present_info = {};
 		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -131,43 +270,137 @@ namespace jvsc {
 
 		present_info.pImageIndices = image_index;
 
+		VkPresentIdKHR present_id_info{};
+		present_id_info.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+		present_id_info.swapchainCount = 1;
+		present_id_info.pPresentIds = &m_frame_counter;
+		if (m_wait_for_present)
+			present_info.pNext = &present_id_info;
+
 		auto result = vkQueuePresentKHR(m_present_queue, &present_info);
 
-		m_current_frame = (m_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+		if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)
+		{
+			m_present_id = m_frame_counter;
+		}
+		else
+		{
+			// nothing to wait for until a present goes through again
+			m_present_id = 0;
+			m_frame_pacer.drop_tracking();
+		}
+
+		m_current_frame = (m_current_frame + 1) % m_max_frames_in_flight;
 
 		return result;
 	}
 
+	void JvscRenderer::pace_frame()
+	{
+		JVSC_PROFILE_SCOPE("pace_frame");
+
+		m_frame_pacer.wait_for_next_frame();
+
+		if (m_low_latency)
+		{
+			JVSC_PROFILE_SCOPE("wait for previous frame");
+
+			// one frame queued at most: the next one samples input only once the last is on screen
+			if (m_wait_for_present && m_present_id > 0)
+			{
+				if (m_wait_for_present(m_device, m_swapchain, m_present_id, PRESENT_WAIT_TIMEOUT_NS) == VK_SUCCESS)
+					m_frame_pacer.finish_tracking(m_present_id, JvscProfiler::now_ns(), true);
+			}
+			else if (!m_wait_for_present)
+			{
+				// the previous frame's fence is the closest point to its present there is to wait on
+				uint32_t previous_frame = (m_current_frame + m_max_frames_in_flight - 1) % m_max_frames_in_flight;
+				wait_for_gpu_value(m_frame_values[previous_frame]);
+				m_frame_pacer.finish_tracking(m_frame_ids[previous_frame], JvscProfiler::now_ns(), false);
+			}
+		}
+
+		m_frame_input_ns = JvscProfiler::now_ns();
+		m_frame_paced = true;
+	}
+
 	VkCommandBuffer JvscRenderer::begin_frame()
 	{
-		vkWaitForFences(m_device, 1, &m_in_flight_fences[m_current_frame], VK_TRUE, std::numeric_limits<uint64_t>::max());
-		VkResult result = vkAcquireNextImageKHR(m_device, m_swapchain, std::numeric_limits<uint64_t>::max(), m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &m_image_index);
-	
-		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		if (!m_frame_paced)
+			pace_frame();
+		m_frame_paced = false;
+
+		JVSC_PROFILE_SCOPE("begin_frame");
+
+		{
+			JVSC_PROFILE_SCOPE("wait for frame slot");
+			wait_for_gpu_value(m_frame_values[m_current_frame]);
+		}
+
+		run_deferred_destructions(false);
+		track_latency();
+
+		// this slot's last frame is done, its timestamps are ready without waiting
+		read_gpu_timestamps(m_current_frame);
+
+		VkResult result = VK_SUCCESS;
+		if (m_headless)
+		{
+			m_image_index = m_current_frame;
+		}
+		else
 		{
-			while (m_swapchain_extent.width == 0 || m_swapchain_extent.height == 0)
+			// a resize is picked up before acquiring so this frame already renders at the new size
+			if (m_window->was_resized())
+				recreate_swapchain();
+
+			// out of date leaves the semaphore unsignaled, it is reused to acquire from the new swapchain
+			result = vkAcquireNextImageKHR(m_device, m_swapchain, std::numeric_limits<uint64_t>::max(), m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &m_image_index);
+			while (result == VK_ERROR_OUT_OF_DATE_KHR)
 			{
-				handle_minimize();
+				recreate_swapchain();
+				result = vkAcquireNextImageKHR(m_device, m_swapchain, std::numeric_limits<uint64_t>::max(), m_image_available_semaphores[m_current_frame], VK_NULL_HANDLE, &m_image_index);
 			}
 		}
+
+		// suboptimal still acquired an image, the swapchain is recreated after this frame is presented
 		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
 			throw std::runtime_error("failed to acquire swapchain image");
 
+		// the frame's fence has signaled, so everything allocated from its pool can be recycled at once
+		vkResetCommandPool(m_device, m_frame_command_pools[m_current_frame], 0);
+
 		VkCommandBufferBeginInfo begin_info{};
 		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		if (vkBeginCommandBuffer(m_command_buffers[m_image_index], &begin_info) != VK_SUCCESS)
+		if (vkBeginCommandBuffer(m_command_buffers[m_current_frame], &begin_info) != VK_SUCCESS)
 			throw std::runtime_error("failed to begin recording command buffer");
 
-		return m_command_buffers[m_image_index];
+		// decided once per frame so every scope of a frame lands in a pool reset by that frame
+		m_timing_frame = m_supports_timestamps && JvscProfiler::enabled();
+		if (m_timing_frame)
+		{
+			vkCmdResetQueryPool(m_command_buffers[m_current_frame], m_timestamp_pools[m_current_frame], 0, MAX_GPU_SCOPES * 2);
+			m_frame_scope = begin_gpu_scope(m_command_buffers[m_current_frame], "gpu frame");
+		}
+
+		return m_command_buffers[m_current_frame];
 	}
 
-	void JvscRenderer::begin_swapchain_render_pass(VkCommandBuffer cmd)
+	void JvscRenderer::begin_swapchain_render_pass(VkCommandBuffer cmd, VkSubpassContents contents)
 	{
+		if (uses_dynamic_rendering())
+		{
+			m_render_pass_scope = begin_gpu_scope(cmd, "render pass");
+			begin_dynamic_rendering(cmd, contents);
+			return;
+		}
+
 		VkRenderPassBeginInfo render_info{};
 		render_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		render_info.renderPass = m_render_pass;
-		render_info.framebuffer = m_swapchain_framebuffers[m_image_index];
+		render_info.framebuffer = current_framebuffer();
 
 		render_info.renderArea.offset = { 0, 0 };
 		render_info.renderArea.extent = m_swapchain_extent;
@@ -178,34 +411,486 @@ namespace jvsc {
 
 		render_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
 		render_info.pClearValues = clear_values.data();
-		vkCmdBeginRenderPass(cmd, &render_info, VK_SUBPASS_CONTENTS_INLINE);
+
+		m_render_pass_scope = begin_gpu_scope(cmd, "render pass");
+		vkCmdBeginRenderPass(cmd, &render_info, contents);
+	}
+
+	void JvscRenderer::end_swapchain_render_pass(VkCommandBuffer cmd)
+	{
+		if (uses_dynamic_rendering())
+			end_dynamic_rendering(cmd);
+		else
+			vkCmdEndRenderPass(cmd);
+		end_gpu_scope(cmd, m_render_pass_scope);
+		m_render_pass_scope = NO_GPU_SCOPE;
+	}
+
+	void JvscRenderer::set_swapchain_viewport(VkCommandBuffer cmd) const
+	{
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(m_swapchain_extent.width);
+		viewport.height = static_cast<float>(m_swapchain_extent.height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+
+		VkRect2D scissor{ {0, 0}, m_swapchain_extent };
+
+		vkCmdSetViewport(cmd, 0, 1, &viewport);
+		vkCmdSetScissor(cmd, 0, 1, &scissor);
+	}
+
+	void JvscRenderer::begin_dynamic_rendering(VkCommandBuffer cmd, VkSubpassContents contents)
+	{
+		// what the render pass's initial layouts and external dependency do: the old contents are
+		// discarded and the attachment writes wait for the stage the acquire semaphore is waited at
+		VkImageMemoryBarrier barriers[2]{};
+		barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[0].srcAccessMask = 0;
+		barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[0].image = m_swapchain_images[m_image_index];
+		barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		// the slot's depth image was last written by the slot's previous frame
+		barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barriers[1].image = m_depth_images[m_current_frame];
+		barriers[1].subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+		if (has_stencil_component(m_depth_image_format))
+			barriers[1].subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+		VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		vkCmdPipelineBarrier(cmd, stages, stages, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+		VkRenderingAttachmentInfoKHR color_attachment{};
+		color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		color_attachment.imageView = m_swapchain_image_views[m_image_index];
+		color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		color_attachment.clearValue.color = { 0.1f, 0.1f, 0.1f, 1.0f };
+
+		VkRenderingAttachmentInfoKHR depth_attachment{};
+		depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+		depth_attachment.imageView = m_depth_image_views[m_current_frame];
+		depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depth_attachment.clearValue.depthStencil = { 1.0f, 0 };
+
+		VkRenderingInfoKHR rendering_info{};
+		rendering_info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+		if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+			rendering_info.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+		rendering_info.renderArea.offset = { 0, 0 };
+		rendering_info.renderArea.extent = m_swapchain_extent;
+		rendering_info.layerCount = 1;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachments = &color_attachment;
+		rendering_info.pDepthAttachment = &depth_attachment;
+
+		m_cmd_begin_rendering(cmd, &rendering_info);
+	}
+
+	void JvscRenderer::end_dynamic_rendering(VkCommandBuffer cmd)
+	{
+		m_cmd_end_rendering(cmd);
+
+		// the render pass's final layout, presented or read back by read_back_last_frame()
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		barrier.dstAccessMask = m_headless ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		barrier.newLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_swapchain_images[m_image_index];
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		VkPipelineStageFlags dst_stage = m_headless ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 	}
 
 	void JvscRenderer::end_frame(VkCommandBuffer cmd)
 	{
+		JVSC_PROFILE_SCOPE("end_frame");
+
+		// the render pass may have been ended with vkCmdEndRenderPass directly, dynamic rendering has to
+		// go through end_swapchain_render_pass() for the layout transition
+		end_gpu_scope(cmd, m_render_pass_scope);
+		end_gpu_scope(cmd, m_frame_scope);
+		m_render_pass_scope = NO_GPU_SCOPE;
+		m_frame_scope = NO_GPU_SCOPE;
+
 		if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
 			throw std::runtime_error("failed to record command buffer");
 
+		// pending uploads are submitted ahead of the frame so its draws see them
+		m_uploader->flush();
+
+		m_frame_submit_ns[m_current_frame] = JvscProfiler::now_ns();
+
 		VkResult result = submit_command_buffers(&m_image_index);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || (!m_headless && m_window->was_resized()))
 		{
-			handle_minimize();
+			recreate_swapchain();
 			return;
 		}
 		if (result != VK_SUCCESS)
 			throw std::runtime_error("failed to present swapchain image");
 	}
 
+	uint32_t JvscRenderer::begin_gpu_scope(VkCommandBuffer cmd, const char* name)
+	{
+		uint32_t& query_count = m_timestamp_query_counts[m_current_frame];
+		if (!m_timing_frame || query_count + 2 > MAX_GPU_SCOPES * 2)
+			return NO_GPU_SCOPE;
+
+		auto& scopes = m_gpu_scopes[m_current_frame];
+		scopes.push_back(GpuTimestampScope{ name, query_count, query_count + 1 });
+		query_count += 2;
+
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_pools[m_current_frame], scopes.back().begin_query);
+		return static_cast<uint32_t>(scopes.size() - 1);
+	}
+
+	void JvscRenderer::end_gpu_scope(VkCommandBuffer cmd, uint32_t scope)
+	{
+		if (scope == NO_GPU_SCOPE)
+			return;
+
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_pools[m_current_frame], m_gpu_scopes[m_current_frame][scope].end_query);
+	}
+
+	void JvscRenderer::read_gpu_timestamps(uint32_t frame)
+	{
+		uint32_t query_count = m_timestamp_query_counts[frame];
+		auto& scopes = m_gpu_scopes[frame];
+		m_timestamp_query_counts[frame] = 0;
+		if (query_count == 0)
+			return;
+
+		// no wait flag: a scope left open never gets its end written, the frame is dropped rather than blocking
+		uint64_t timestamps[MAX_GPU_SCOPES * 2];
+		VkResult result = vkGetQueryPoolResults(m_device, m_timestamp_pools[frame], 0, query_count, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+		if (result == VK_SUCCESS && JvscProfiler::enabled())
+		{
+			// GPU ticks have no relation to the CPU clock, so the first timestamp is pinned to the submit time
+			uint64_t origin = timestamps[0] & m_timestamp_mask;
+			for (const GpuTimestampScope& scope : scopes)
+			{
+				uint64_t begin = timestamps[scope.begin_query] & m_timestamp_mask;
+				uint64_t end = timestamps[scope.end_query] & m_timestamp_mask;
+				uint64_t start_ns = m_frame_submit_ns[frame] + static_cast<uint64_t>(static_cast<double>(begin - origin) * m_timestamp_period);
+				uint64_t duration_ns = static_cast<uint64_t>(static_cast<double>(end - begin) * m_timestamp_period);
+				JvscProfiler::get().record_gpu(scope.name, start_ns, duration_ns);
+			}
+		}
+
+		scopes.clear();
+	}
+
+	void JvscRenderer::track_latency()
+	{
+		if (!m_wait_for_present)
+		{
+			// this slot's frame is done on the GPU, present time is unknown
+			m_frame_pacer.finish_tracking(m_frame_ids[m_current_frame], JvscProfiler::now_ns(), false);
+			return;
+		}
+
+		// polled with a zero timeout, so a sample ends when its present is first seen complete, up to a frame late
+		for (uint64_t id = m_frame_pacer.oldest_tracked(); id != 0 && id <= m_present_id; id = m_frame_pacer.oldest_tracked())
+		{
+			VkResult result = m_wait_for_present(m_device, m_swapchain, id, 0);
+			if (result == VK_TIMEOUT)
+				break;
+			if (result != VK_SUCCESS)
+			{
+				m_frame_pacer.drop_tracking();
+				break;
+			}
+			m_frame_pacer.finish_tracking(id, JvscProfiler::now_ns(), true);
+		}
+	}
+
+	void JvscRenderer::defer_destruction(std::function<void()> destroy)
+	{
+		m_deferred_destructions.push_back(DeferredDestruction{ m_submitted_value, std::move(destroy) });
+	}
+
+	void JvscRenderer::run_deferred_destructions(bool all)
+	{
+		while (!m_deferred_destructions.empty() && (all || gpu_value_reached(m_deferred_destructions.front().gpu_value)))
+		{
+			m_deferred_destructions.front().destroy();
+			m_deferred_destructions.pop_front();
+		}
+	}
+
+	uint64_t JvscRenderer::submit(VkSubmitInfo submit_info)
+	{
+		uint64_t value = m_submitted_value + 1;
+
+		if (m_timeline_semaphore != VK_NULL_HANDLE)
+		{
+			// appended to the caller's signal semaphores, the binary ones ignore their values
+			m_submit_signal_semaphores.assign(submit_info.pSignalSemaphores, submit_info.pSignalSemaphores + submit_info.signalSemaphoreCount);
+			m_submit_signal_values.assign(submit_info.signalSemaphoreCount, 0);
+			m_submit_signal_semaphores.push_back(m_timeline_semaphore);
+			m_submit_signal_values.push_back(value);
+
+			VkTimelineSemaphoreSubmitInfo timeline_info{};
+			timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timeline_info.pNext = submit_info.pNext;
+			timeline_info.signalSemaphoreValueCount = static_cast<uint32_t>(m_submit_signal_values.size());
+			timeline_info.pSignalSemaphoreValues = m_submit_signal_values.data();
+
+			submit_info.pNext = &timeline_info;
+			submit_info.signalSemaphoreCount = static_cast<uint32_t>(m_submit_signal_semaphores.size());
+			submit_info.pSignalSemaphores = m_submit_signal_semaphores.data();
+
+			if (vkQueueSubmit(m_graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+				throw std::runtime_error("failed to submit to the graphics queue");
+		}
+		else
+		{
+			VkFence fence;
+			if (!m_free_fences.empty())
+			{
+				fence = m_free_fences.back();
+				m_free_fences.pop_back();
+				vkResetFences(m_device, 1, &fence);
+			}
+			else
+			{
+				VkFenceCreateInfo fence_info = {};
+				fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+				if (vkCreateFence(m_device, &fence_info, nullptr, &fence) != VK_SUCCESS)
+					throw std::runtime_error("failed to create submission fence");
+			}
+
+			if (vkQueueSubmit(m_graphics_queue, 1, &submit_info, fence) != VK_SUCCESS)
+				throw std::runtime_error("failed to submit to the graphics queue");
+			m_pending_fences.push_back(PendingFence{ value, fence });
+		}
+
+		m_submitted_value = value;
+		return value;
+	}
+
+	uint64_t JvscRenderer::completed_gpu_value()
+	{
+		if (m_timeline_semaphore != VK_NULL_HANDLE)
+		{
+			uint64_t value = 0;
+			m_get_semaphore_counter_value(m_device, m_timeline_semaphore, &value);
+			m_completed_value = std::max(m_completed_value, value);
+			return m_completed_value;
+		}
+
+		// fences are only recycled once signaled themselves, the value may run ahead of them after a wait
+		while (!m_pending_fences.empty() && vkGetFenceStatus(m_device, m_pending_fences.front().fence) == VK_SUCCESS)
+		{
+			m_completed_value = std::max(m_completed_value, m_pending_fences.front().value);
+			m_free_fences.push_back(m_pending_fences.front().fence);
+			m_pending_fences.pop_front();
+		}
+		return m_completed_value;
+	}
+
+	void JvscRenderer::wait_for_gpu_value(uint64_t value)
+	{
+		if (value <= m_completed_value)
+			return;
+		if (value > m_submitted_value)
+			throw std::runtime_error("waiting for a GPU value that was never submitted");
+
+		JVSC_PROFILE_SCOPE("wait for gpu");
+
+		if (m_timeline_semaphore != VK_NULL_HANDLE)
+		{
+			VkSemaphoreWaitInfo wait_info{};
+			wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			wait_info.semaphoreCount = 1;
+			wait_info.pSemaphores = &m_timeline_semaphore;
+			wait_info.pValues = &value;
+			if (m_wait_semaphores(m_device, &wait_info, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS)
+				throw std::runtime_error("failed to wait for timeline semaphore");
+			m_completed_value = std::max(m_completed_value, value);
+			return;
+		}
+
+		// every value has its own fence, once it signals everything submitted before it is done too
+		for (const PendingFence& pending : m_pending_fences)
+		{
+			if (pending.value == value)
+			{
+				vkWaitForFences(m_device, 1, &pending.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+				break;
+			}
+		}
+		m_completed_value = std::max(m_completed_value, value);
+		completed_gpu_value();
+	}
+
+	void JvscRenderer::recreate_swapchain()
+	{
+		JVSC_PROFILE_SCOPE("recreate_swapchain");
+
+		handle_minimize();
+		m_window->reset_resized_flag();
+
+		// Frames still in flight keep rendering to and presenting the old images, so the old swapchain
+		// and everything built on it are retired through defer_destruction() instead of waiting on the device.
+		m_old_swapchain = m_swapchain;
+		VkFormat old_format = m_swapchain_image_format;
+		defer_destruction([device = m_device, allocator = m_allocator, swapchain = m_old_swapchain,
+			framebuffers = std::move(m_swapchain_framebuffers), image_views = std::move(m_swapchain_image_views),
+			depth_images = std::move(m_depth_images), depth_image_views = std::move(m_depth_image_views), depth_allocations = std::move(m_depth_image_allocations)]()
+		{
+			for (VkFramebuffer framebuffer : framebuffers)
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			for (size_t i = 0; i < depth_images.size(); i++)
+			{
+				vkDestroyImageView(device, depth_image_views[i], nullptr);
+				vmaDestroyImage(allocator, depth_images[i], depth_allocations[i]);
+			}
+			for (VkImageView image_view : image_views)
+				vkDestroyImageView(device, image_view, nullptr);
+			vkDestroySwapchainKHR(device, swapchain, nullptr);
+		});
+
+		m_swapchain_framebuffers.clear();
+		m_swapchain_image_views.clear();
+		m_depth_images.clear();
+		m_depth_image_views.clear();
+		m_depth_image_allocations.clear();
+
+		create_swapchain();
+		m_old_swapchain = VK_NULL_HANDLE;
+
+		// pipelines are built against the render pass or, with dynamic rendering, the attachment formats,
+		// either way they stay valid only with the same formats
+		if (m_swapchain_image_format != old_format)
+			throw std::runtime_error("swapchain image format changed on recreation");
+
+		create_swapchain_image_views();
+		create_depth_resources();
+		create_framebuffers();
+
+		// the new images have never been submitted
+		m_image_values.assign(m_swapchain_images.size(), 0);
+
+		// present ids of the old swapchain can no longer be waited on
+		m_present_id = 0;
+		m_frame_pacer.drop_tracking();
+	}
+
 	void JvscRenderer::handle_minimize()
 	{
-		auto extent = m_window.get_extent();
+		if (m_headless)
+			return;
+
+		auto extent = m_window->get_extent();
 		while (extent.width == 0 || extent.height == 0)
 		{
-			extent = m_window.get_extent();
+			extent = m_window->get_extent();
 			glfwWaitEvents();
 		}
 	}
 
+	void JvscRenderer::read_back_last_frame(std::vector<uint8_t>& pixels)
+	{
+		if (!m_headless)
+			throw std::runtime_error("read back is only available in headless mode");
+
+		if (m_image_values[m_last_image_index] == 0)
+			throw std::runtime_error("no frame has been rendered yet");
+
+		VkDeviceSize size = static_cast<VkDeviceSize>(m_swapchain_extent.width) * m_swapchain_extent.height * 4;
+
+		VkBufferCreateInfo buffer_info{};
+		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size = size;
+		buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo alloc_info{};
+		alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+		alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+		VkBuffer buffer;
+		VmaAllocation allocation;
+		VmaAllocationInfo allocation_info;
+		if (vmaCreateBuffer(m_allocator, &buffer_info, &alloc_info, &buffer, &allocation, &allocation_info) != VK_SUCCESS)
+			throw std::runtime_error("failed to create read back buffer");
+
+		VkCommandBufferAllocateInfo cmd_info{};
+		cmd_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmd_info.commandPool = m_command_pool;
+		cmd_info.commandBufferCount = 1;
+
+		VkCommandBuffer cmd;
+		if (vkAllocateCommandBuffers(m_device, &cmd_info, &cmd) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate read back command buffer");
+
+		VkCommandBufferBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(cmd, &begin_info);
+
+		// the copy is no longer ordered by a wait on the CPU, only by this barrier against the frame's render pass
+		VkMemoryBarrier render_barrier{};
+		render_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		render_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		render_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &render_barrier, 0, nullptr, 0, nullptr);
+
+		// the render pass leaves offscreen images in TRANSFER_SRC_OPTIMAL
+		VkBufferImageCopy region{};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { m_swapchain_extent.width, m_swapchain_extent.height, 1 };
+		vkCmdCopyImageToBuffer(cmd, m_swapchain_images[m_last_image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		vkEndCommandBuffer(cmd);
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &cmd;
+		// queued behind the frame on the same queue, one wait covers both
+		wait_for_gpu_value(submit(submit_info));
+
+		vmaInvalidateAllocation(m_allocator, allocation, 0, VK_WHOLE_SIZE);
+		pixels.resize(static_cast<size_t>(size));
+		memcpy(pixels.data(), allocation_info.pMappedData, static_cast<size_t>(size));
+
+		vkFreeCommandBuffers(m_device, m_command_pool, 1, &cmd);
+		vmaDestroyBuffer(m_allocator, buffer, allocation);
+	}
+
 
 	void JvscRenderer::create_instance()
 	{
@@ -215,13 +900,31 @@ namespace jvsc {
 		app_info.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
 		app_info.pEngineName = "JvscVulkanEngine";
 		app_info.engineVersion = VK_MAKE_VERSION(0, 0, 1);
-		app_info.apiVersion = VK_API_VERSION_1_0;
+
+		// 1.2 brings timeline semaphores, a 1.0 loader rejects anything above 1.0 and lacks vkEnumerateInstanceVersion
+		auto enumerate_instance_version = (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion");
+		uint32_t loader_version = VK_API_VERSION_1_0;
+		if (enumerate_instance_version)
+			enumerate_instance_version(&loader_version);
+		m_api_version = loader_version >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+		app_info.apiVersion = m_api_version;
 
 		VkInstanceCreateInfo instance_info = {};
 		instance_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 		instance_info.pApplicationInfo = &app_info;
 
 		auto extensions = get_required_extensions();
+
+		uint32_t available_count = 0;
+		vkEnumerateInstanceExtensionProperties(nullptr, &available_count, nullptr);
+		std::vector<VkExtensionProperties> available_extensions(available_count);
+		vkEnumerateInstanceExtensionProperties(nullptr, &available_count, available_extensions.data());
+
+		// optional, needed on 1.0 to query the features of device extensions such as present_wait
+		m_has_physical_device_properties2 = has_extension(available_extensions, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+		if (m_has_physical_device_properties2)
+			extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
 		instance_info.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 		instance_info.ppEnabledExtensionNames = extensions.data();
 
@@ -253,7 +956,7 @@ namespace jvsc {
 
 	void JvscRenderer::create_surface()
 	{
-		m_window.create_surface(m_instance, &m_surface);
+		m_window->create_surface(m_instance, &m_surface);
 	}
 
 	void JvscRenderer::select_physical_device()
@@ -298,18 +1001,134 @@ namespace jvsc {
 			queue_create_infos.push_back(queue_info);
 		}
 
+		VkPhysicalDeviceFeatures supported_features;
+		vkGetPhysicalDeviceFeatures(m_physical_device, &supported_features);
+
 		VkPhysicalDeviceFeatures device_features = {};
 		device_features.samplerAnisotropy = VK_TRUE;
 
+		// optional, GPU-driven drawing falls back to the CPU path without them
+		m_supports_indirect_draws = supported_features.multiDrawIndirect && supported_features.drawIndirectFirstInstance;
+		device_features.multiDrawIndirect = supported_features.multiDrawIndirect;
+		device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+
+		uint32_t extension_count;
+		vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, nullptr);
+		std::vector<VkExtensionProperties> available_extensions(extension_count);
+		vkEnumerateDeviceExtensionProperties(m_physical_device, nullptr, &extension_count, available_extensions.data());
+
+		std::vector<const char*> enabled_extensions = device_extensions;
+		bool has_draw_indirect_count = has_extension(available_extensions, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		if (has_draw_indirect_count)
+			enabled_extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+		// Features of extensions and newer versions are queried and enabled through a VkPhysicalDeviceFeatures2
+		// chain, core from 1.1 and through VK_KHR_get_physical_device_properties2 before that.
+		PFN_vkGetPhysicalDeviceFeatures2KHR get_features2 = nullptr;
+		if (m_api_version >= VK_API_VERSION_1_1)
+			get_features2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2");
+		else if (m_has_physical_device_properties2)
+			get_features2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR");
+
+		// optional, lets pace_frame() wait for presents and the latency end at the present
+		VkPhysicalDevicePresentIdFeaturesKHR present_id_features{};
+		present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+		VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features{};
+		present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+		bool has_present_wait = get_features2 && !m_headless
+			&& has_extension(available_extensions, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+			&& has_extension(available_extensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+
+		// optional, submit() falls back to fences without them
+		VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features{};
+		timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		bool has_timeline_semaphores = get_features2 && m_timeline_semaphores_allowed
+			&& m_api_version >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2;
+
+		// optional, begin_swapchain_render_pass() uses a VkRenderPass without it. Its dependencies
+		// (VK_KHR_depth_stencil_resolve, VK_KHR_create_renderpass2) are core in 1.2
+		VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features{};
+		dynamic_rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+		bool has_dynamic_rendering = get_features2 && m_dynamic_rendering_allowed
+			&& m_api_version >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2
+			&& has_extension(available_extensions, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+
+		// optional, pipelines that differ only in these states could share one VkPipeline with it
+		VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extended_dynamic_state_features{};
+		extended_dynamic_state_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+		bool has_extended_dynamic_state = get_features2 && m_extended_dynamic_state_allowed
+			&& has_extension(available_extensions, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+		// the same structs are chained twice: everything that may exist to query, then only what is supported to enable
+		auto build_feature_chain = [&]() {
+			void* chain = nullptr;
+			if (has_present_wait)
+			{
+				present_id_features.pNext = chain;
+				present_wait_features.pNext = &present_id_features;
+				chain = &present_wait_features;
+			}
+			if (has_timeline_semaphores)
+			{
+				timeline_features.pNext = chain;
+				chain = &timeline_features;
+			}
+			if (has_dynamic_rendering)
+			{
+				dynamic_rendering_features.pNext = chain;
+				chain = &dynamic_rendering_features;
+			}
+			if (has_extended_dynamic_state)
+			{
+				extended_dynamic_state_features.pNext = chain;
+				chain = &extended_dynamic_state_features;
+			}
+			return chain;
+		};
+
+		features2.pNext = build_feature_chain();
+		if (features2.pNext)
+		{
+			get_features2(m_physical_device, &features2);
+			has_present_wait = has_present_wait && present_id_features.presentId && present_wait_features.presentWait;
+			has_timeline_semaphores = has_timeline_semaphores && timeline_features.timelineSemaphore;
+			has_dynamic_rendering = has_dynamic_rendering && dynamic_rendering_features.dynamicRendering;
+			has_extended_dynamic_state = has_extended_dynamic_state && extended_dynamic_state_features.extendedDynamicState;
+			features2.pNext = build_feature_chain();
+			features2.features = device_features;
+		}
+
+		if (has_present_wait)
+		{
+			enabled_extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+			enabled_extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		}
+		if (has_dynamic_rendering)
+			enabled_extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		if (has_extended_dynamic_state)
+			enabled_extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+
 		VkDeviceCreateInfo device_info = {};
 		device_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
 		device_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
 		device_info.pQueueCreateInfos = queue_create_infos.data();
 
-		device_info.pEnabledFeatures = &device_features;
-		device_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
-		device_info.ppEnabledExtensionNames = device_extensions.data();
+		// a VkPhysicalDeviceFeatures2 chain replaces pEnabledFeatures
+		if (features2.pNext)
+		{
+			features2.features = device_features;
+			device_info.pNext = &features2;
+		}
+		else
+		{
+			device_info.pEnabledFeatures = &device_features;
+		}
+		device_info.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
+		device_info.ppEnabledExtensionNames = enabled_extensions.data();
 
 		// deprecated
 		if (enable_validation_layers) {
@@ -326,6 +1145,30 @@ namespace jvsc {
 
 		vkGetDeviceQueue(m_device, m_graphics_family_index, 0, &m_graphics_queue);
 		vkGetDeviceQueue(m_device, m_present_family_index, 0, &m_present_queue);
+
+		if (has_draw_indirect_count)
+			m_draw_indexed_indirect_count = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR");
+		if (has_present_wait)
+			m_wait_for_present = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(m_device, "vkWaitForPresentKHR");
+		if (has_timeline_semaphores)
+		{
+			m_wait_semaphores = (PFN_vkWaitSemaphores)vkGetDeviceProcAddr(m_device, "vkWaitSemaphores");
+			m_get_semaphore_counter_value = (PFN_vkGetSemaphoreCounterValue)vkGetDeviceProcAddr(m_device, "vkGetSemaphoreCounterValue");
+		}
+		if (has_dynamic_rendering)
+		{
+			m_cmd_begin_rendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(m_device, "vkCmdBeginRenderingKHR");
+			m_cmd_end_rendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(m_device, "vkCmdEndRenderingKHR");
+		}
+		if (has_extended_dynamic_state)
+		{
+			m_extended_dynamic_state.set_cull_mode = (PFN_vkCmdSetCullModeEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetCullModeEXT");
+			m_extended_dynamic_state.set_front_face = (PFN_vkCmdSetFrontFaceEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetFrontFaceEXT");
+			m_extended_dynamic_state.set_primitive_topology = (PFN_vkCmdSetPrimitiveTopologyEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetPrimitiveTopologyEXT");
+			m_extended_dynamic_state.set_depth_test_enable = (PFN_vkCmdSetDepthTestEnableEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetDepthTestEnableEXT");
+			m_extended_dynamic_state.set_depth_write_enable = (PFN_vkCmdSetDepthWriteEnableEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetDepthWriteEnableEXT");
+			m_extended_dynamic_state.set_depth_compare_op = (PFN_vkCmdSetDepthCompareOpEXT)vkGetDeviceProcAddr(m_device, "vkCmdSetDepthCompareOpEXT");
+		}
 	}
 
 	void JvscRenderer::create_allocator()
@@ -339,6 +1182,94 @@ namespace jvsc {
 			throw std::runtime_error("failed to create allocator");
 	}
 
+	void JvscRenderer::create_pipeline_cache()
+	{
+		std::vector<char> data;
+
+		if (!m_pipeline_cache_path.empty())
+		{
+			std::ifstream file(m_pipeline_cache_path, std::ios::ate | std::ios::binary);
+			if (file.is_open())
+			{
+				data.resize(static_cast<size_t>(file.tellg()));
+				file.seekg(0);
+				file.read(data.data(), data.size());
+				if (!file)
+					data.clear();
+			}
+		}
+
+		if (!data.empty() && !is_pipeline_cache_valid(data))
+		{
+			std::cout << "discarding pipeline cache: " << m_pipeline_cache_path << " was created by another device or driver, or is corrupt" << '\n';
+			data.clear();
+		}
+
+		VkPipelineCacheCreateInfo cache_info{};
+		cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		cache_info.initialDataSize = data.size();
+		cache_info.pInitialData = data.empty() ? nullptr : data.data();
+
+		m_pipeline_cache_warm = !data.empty();
+		if (vkCreatePipelineCache(m_device, &cache_info, nullptr, &m_pipeline_cache) == VK_SUCCESS)
+			return;
+
+		// the driver rejected the blob despite a valid header, start cold instead of failing
+		std::cout << "discarding pipeline cache: driver rejected " << m_pipeline_cache_path << '\n';
+		cache_info.initialDataSize = 0;
+		cache_info.pInitialData = nullptr;
+		m_pipeline_cache_warm = false;
+
+		if (vkCreatePipelineCache(m_device, &cache_info, nullptr, &m_pipeline_cache) != VK_SUCCESS)
+			throw std::runtime_error("failed to create pipeline cache");
+	}
+
+	void JvscRenderer::save_pipeline_cache()
+	{
+		if (m_pipeline_cache_path.empty())
+			return;
+
+		size_t size = 0;
+		if (vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, nullptr) != VK_SUCCESS || size == 0)
+			return;
+
+		std::vector<char> data(size);
+		if (vkGetPipelineCacheData(m_device, m_pipeline_cache, &size, data.data()) != VK_SUCCESS)
+			return;
+
+		// write next to the target and rename, so a crash mid-write never leaves a truncated cache behind
+		std::string temp_path = m_pipeline_cache_path + ".tmp";
+		{
+			std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+			if (!file.is_open())
+				return;
+			file.write(data.data(), static_cast<std::streamsize>(size));
+			if (!file)
+				return;
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temp_path, m_pipeline_cache_path, error);
+		if (error)
+			std::filesystem::remove(temp_path, error);
+	}
+
+	bool JvscRenderer::is_pipeline_cache_valid(const std::vector<char>& data) const
+	{
+		VkPipelineCacheHeaderVersionOne header{};
+		if (data.size() < sizeof(header))
+			return false;
+
+		memcpy(&header, data.data(), sizeof(header));
+
+		return header.headerSize >= sizeof(header)
+			&& header.headerSize <= data.size()
+			&& header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+			&& header.vendorID == properties.vendorID
+			&& header.deviceID == properties.deviceID
+			&& memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
 	void JvscRenderer::create_command_pool()
 	{
 		VkCommandPoolCreateInfo pool_info = {};
@@ -348,6 +1279,16 @@ namespace jvsc {
 
 		if (vkCreateCommandPool(m_device, &pool_info, nullptr, &m_command_pool) != VK_SUCCESS)
 			throw std::runtime_error("failed to create command pool!");
+
+		// frame pools are reset as a whole, so individual buffer resets are not needed
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		m_frame_command_pools.resize(m_max_frames_in_flight);
+		for (size_t i = 0; i < m_frame_command_pools.size(); i++)
+		{
+			if (vkCreateCommandPool(m_device, &pool_info, nullptr, &m_frame_command_pools[i]) != VK_SUCCESS)
+				throw std::runtime_error("failed to create frame command pool!");
+		}
 	}
 
 	void JvscRenderer::create_swapchain()
@@ -388,8 +1329,9 @@ namespace jvsc {
 		swapchain_info.preTransform = swapchain_support.capabilities.currentTransform;
 		swapchain_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 		swapchain_info.presentMode = present_mode;
+		m_present_mode = present_mode;
 		swapchain_info.clipped = VK_TRUE;
-		swapchain_info.oldSwapchain = oldSwapChain == nullptr ? VK_NULL_HANDLE : oldSwapChain;
+		swapchain_info.oldSwapchain = m_old_swapchain;
 
 		if (vkCreateSwapchainKHR(m_device, &swapchain_info, nullptr, &m_swapchain) != VK_SUCCESS)
 			throw std::runtime_error("failed to create swap chain!");
@@ -402,6 +1344,38 @@ namespace jvsc {
 		m_swapchain_extent = extent;
 	}
 
+	void JvscRenderer::create_offscreen_images()
+	{
+		m_swapchain_image_format = find_supported_format({ VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_B8G8R8A8_UNORM }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
+
+		m_swapchain_images.resize(m_max_frames_in_flight);
+		m_offscreen_image_allocations.resize(m_max_frames_in_flight);
+
+		for (size_t i = 0; i < m_swapchain_images.size(); i++)
+		{
+			VkImageCreateInfo image_info{};
+			image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			image_info.imageType = VK_IMAGE_TYPE_2D;
+			image_info.extent.width = m_swapchain_extent.width;
+			image_info.extent.height = m_swapchain_extent.height;
+			image_info.extent.depth = 1;
+			image_info.mipLevels = 1;
+			image_info.arrayLayers = 1;
+			image_info.format = m_swapchain_image_format;
+			image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+			image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+			image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VmaAllocationCreateInfo alloc_info = {};
+			alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+			if (vmaCreateImage(m_allocator, &image_info, &alloc_info, &m_swapchain_images[i], &m_offscreen_image_allocations[i], nullptr) != VK_SUCCESS)
+				throw std::runtime_error("failed to create offscreen image");
+		}
+	}
+
 	void JvscRenderer::create_swapchain_image_views()
 	{
 		m_swapchain_image_views.resize(m_swapchain_images.size());
@@ -425,36 +1399,46 @@ namespace jvsc {
 
 	void JvscRenderer::create_depth_resources()
 	{
-
-		m_depth_image_format = find_supported_format({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
-
-		m_depth_images.resize(m_swapchain_images.size());
-		m_depth_image_views.resize(m_swapchain_images.size());
-		m_depth_image_allocations.resize(m_swapchain_images.size());
-
-		for (int i = 0; i < m_depth_images.size(); i++)
-		{
-			VkImageCreateInfo image_info{};
-			image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-			image_info.imageType = VK_IMAGE_TYPE_2D;
-			image_info.extent.width = m_swapchain_extent.width;
-			image_info.extent.height = m_swapchain_extent.height;
-			image_info.extent.depth = 1;
-			image_info.mipLevels = 1;
-			image_info.arrayLayers = 1;
-			image_info.format = m_depth_image_format;
-			image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
-			image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-			image_info.samples = VK_SAMPLE_COUNT_1_BIT;
-			image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			image_info.flags = 0;
-
-			VmaAllocationCreateInfo alloc_info = {};
+		// Depth is cleared on load and never stored, so only the frames in flight need their own image
+		// and its contents never have to reach memory: transient usage lets tilers keep it on chip and
+		// lazily allocated memory, where the device has it, backs it with nothing at all.
+		m_depth_image_format = choose_depth_format();
+
+		m_depth_images.resize(m_max_frames_in_flight);
+		m_depth_image_views.resize(m_max_frames_in_flight);
+		m_depth_image_allocations.resize(m_max_frames_in_flight);
+		m_depth_memory_bytes = 0;
+
+		VkImageCreateInfo image_info{};
+		image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_info.imageType = VK_IMAGE_TYPE_2D;
+		image_info.extent.width = m_swapchain_extent.width;
+		image_info.extent.height = m_swapchain_extent.height;
+		image_info.extent.depth = 1;
+		image_info.mipLevels = 1;
+		image_info.arrayLayers = 1;
+		image_info.format = m_depth_image_format;
+		image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		image_info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image_info.flags = 0;
+
+		VmaAllocationCreateInfo alloc_info = {};
+		alloc_info.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+
+		uint32_t memory_type_index;
+		m_depth_lazily_allocated = vmaFindMemoryTypeIndexForImageInfo(m_allocator, &image_info, &alloc_info, &memory_type_index) == VK_SUCCESS;
+		if (!m_depth_lazily_allocated)
 			alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
 
-			if (vmaCreateImage(m_allocator, &image_info, &alloc_info, &m_depth_images[i], &m_depth_image_allocations[i], nullptr) != VK_SUCCESS)
+		for (size_t i = 0; i < m_depth_images.size(); i++)
+		{
+			VmaAllocationInfo allocation_info{};
+			if (vmaCreateImage(m_allocator, &image_info, &alloc_info, &m_depth_images[i], &m_depth_image_allocations[i], &allocation_info) != VK_SUCCESS)
 				throw std::runtime_error("failed to create depth image");
+			m_depth_memory_bytes += allocation_info.size;
 
 			VkImageViewCreateInfo view_info{};
 			view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -472,8 +1456,41 @@ namespace jvsc {
 		}
 	}
 
+	VkFormat JvscRenderer::choose_depth_format()
+	{
+		struct DepthFormat
+		{
+			VkFormat format;
+			uint32_t depth_bits;
+		};
+
+		// cheapest first, the stencil formats only as a last resort since nothing uses stencil
+		static constexpr DepthFormat candidates[] = {
+			{ VK_FORMAT_D16_UNORM, 16 },			// 2 bytes
+			{ VK_FORMAT_X8_D24_UNORM_PACK32, 24 },	// 4 bytes
+			{ VK_FORMAT_D32_SFLOAT, 32 },			// 4 bytes
+			{ VK_FORMAT_D24_UNORM_S8_UINT, 24 },	// 4 bytes
+			{ VK_FORMAT_D32_SFLOAT_S8_UINT, 32 },	// 5 to 8 bytes
+		};
+
+		std::vector<VkFormat> formats;
+		for (const DepthFormat& candidate : candidates)
+		{
+			if (candidate.depth_bits >= m_depth_bits)
+				formats.push_back(candidate.format);
+		}
+		if (formats.empty())
+			throw std::runtime_error("no depth format has the requested precision");
+
+		return find_supported_format(formats, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	}
+
 	void JvscRenderer::create_render_pass()
 	{
+		// begin_dynamic_rendering() does the render pass's work, framebuffers are skipped as well
+		if (uses_dynamic_rendering())
+			return;
+
 		VkAttachmentDescription color_attachment = {};
 		color_attachment.format = m_swapchain_image_format;
 		color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -482,7 +1499,7 @@ namespace jvsc {
 		color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		color_attachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentReference color_attachment_ref = {};
 		color_attachment_ref.attachment = 0;
@@ -532,10 +1549,14 @@ namespace jvsc {
 
 	void JvscRenderer::create_framebuffers()
 	{
-		m_swapchain_framebuffers.resize(m_swapchain_images.size());
+		if (uses_dynamic_rendering())
+			return;
+
+		// one per swapchain image and frame slot pair, the slot picks the depth image
+		m_swapchain_framebuffers.resize(m_swapchain_images.size() * m_max_frames_in_flight);
 		for (size_t i = 0; i < m_swapchain_framebuffers.size(); i++) 
 		{
-			std::vector<VkImageView> attachments = { m_swapchain_image_views[i], m_depth_image_views[i] };
+			std::vector<VkImageView> attachments = { m_swapchain_image_views[i / m_max_frames_in_flight], m_depth_image_views[i % m_max_frames_in_flight] };
 
 			VkFramebufferCreateInfo framebuffer_info = {};
 			framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
@@ -554,48 +1575,100 @@ namespace jvsc {
 
 	void JvscRenderer::create_sync_objects()
 	{
-		m_image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-		m_in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
-		m_images_in_flight.resize(m_swapchain_images.size(), VK_NULL_HANDLE);
+		m_image_available_semaphores.resize(m_max_frames_in_flight);
+		m_render_finished_semaphores.resize(m_max_frames_in_flight);
+		m_frame_values.resize(m_max_frames_in_flight, 0);
+		m_image_values.resize(m_swapchain_images.size(), 0);
+		m_frame_ids.resize(m_max_frames_in_flight, 0);
 
+		// the swapchain only takes binary semaphores, frame completion is tracked through submit()
 		VkSemaphoreCreateInfo semaphore_info = {};
 		semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-		VkFenceCreateInfo fence_info = {};
-		fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		for (size_t i = 0; i < m_max_frames_in_flight; i++) {
 			if (vkCreateSemaphore(m_device, &semaphore_info, nullptr, &m_image_available_semaphores[i]) != VK_SUCCESS ||
-				vkCreateSemaphore(m_device, &semaphore_info, nullptr, &m_render_finished_semaphores[i]) != VK_SUCCESS ||
-				vkCreateFence(m_device, &fence_info, nullptr, &m_in_flight_fences[i]) != VK_SUCCESS) {
+				vkCreateSemaphore(m_device, &semaphore_info, nullptr, &m_render_finished_semaphores[i]) != VK_SUCCESS) {
 				throw std::runtime_error("failed to create synchronization objects for a frame!");
 			}
 		}
+
+		if (!m_wait_semaphores)
+			return;
+
+		VkSemaphoreTypeCreateInfo type_info{};
+		type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		type_info.initialValue = 0;
+
+		VkSemaphoreCreateInfo timeline_info = {};
+		timeline_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		timeline_info.pNext = &type_info;
+
+		if (vkCreateSemaphore(m_device, &timeline_info, nullptr, &m_timeline_semaphore) != VK_SUCCESS)
+			throw std::runtime_error("failed to create timeline semaphore");
 	}
 
 	void JvscRenderer::create_command_buffers()
 	{
-		m_command_buffers.resize(m_swapchain_images.size());
+		m_command_buffers.resize(m_max_frames_in_flight);
+
+		for (size_t i = 0; i < m_command_buffers.size(); i++)
+		{
+			VkCommandBufferAllocateInfo alloc_info{};
+			alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			alloc_info.commandPool = m_frame_command_pools[i];
+			alloc_info.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(m_device, &alloc_info, &m_command_buffers[i]) != VK_SUCCESS)
+				throw std::runtime_error("failed to allocate command buffers");
+		}
+	}
+
+	void JvscRenderer::create_timestamp_queries()
+	{
+		m_timestamp_query_counts.resize(m_max_frames_in_flight, 0);
+		m_gpu_scopes.resize(m_max_frames_in_flight);
+		m_frame_submit_ns.resize(m_max_frames_in_flight, 0);
+
+		uint32_t queue_family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &queue_family_count, nullptr);
+		std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &queue_family_count, queue_families.data());
+
+		uint32_t valid_bits = queue_families[m_graphics_family_index].timestampValidBits;
+		m_supports_timestamps = valid_bits > 0 && properties.limits.timestampPeriod > 0.f;
+		if (!m_supports_timestamps)
+			return;
 
-		VkCommandBufferAllocateInfo alloc_info{};
-		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		alloc_info.commandPool = m_command_pool;
-		alloc_info.commandBufferCount = static_cast<uint32_t>(m_command_buffers.size());
+		m_timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (uint64_t{ 1 } << valid_bits) - 1;
+		m_timestamp_period = properties.limits.timestampPeriod;
 
-		if (vkAllocateCommandBuffers(m_device, &alloc_info, m_command_buffers.data()) != VK_SUCCESS)
-			throw std::runtime_error("failed to allocate command buffers");
+		VkQueryPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		pool_info.queryCount = MAX_GPU_SCOPES * 2;
+
+		m_timestamp_pools.resize(m_max_frames_in_flight);
+		for (auto& pool : m_timestamp_pools)
+		{
+			if (vkCreateQueryPool(m_device, &pool_info, nullptr, &pool) != VK_SUCCESS)
+				throw std::runtime_error("failed to create timestamp query pool");
+		}
 	}
 
 	std::vector<const char*> JvscRenderer::get_required_extensions()
 	{
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions;
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		if (!m_headless)
+		{
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		if (enable_validation_layers)
 			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -634,8 +1707,8 @@ namespace jvsc {
 
 		bool extensions_supported = check_device_extension_support(physical_device);
 
-		bool swapchain_adequate = false;
-		if (extensions_supported) 
+		bool swapchain_adequate = m_headless;
+		if (extensions_supported && !m_headless) 
 		{
 			SwapChainSupportDetails swapchain_support = query_swapchain_support(physical_device);
 			swapchain_adequate = !swapchain_support.formats.empty() && !swapchain_support.present_modes.empty();
@@ -688,8 +1761,12 @@ namespace jvsc {
 				indices.graphics_family_index = i;
 				indices.graphics_family_has_value = true;
 			}
+			// headless frames are never presented, the graphics queue stands in for the present queue
 			VkBool32 present_support = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, m_surface, &present_support);
+			if (m_headless)
+				present_support = indices.graphics_family_has_value && indices.graphics_family_index == static_cast<uint32_t>(i);
+			else
+				vkGetPhysicalDeviceSurfaceSupportKHR(physical_device, i, m_surface, &present_support);
 			if (queue_family.queueCount > 0 && present_support) 
 			{
 				indices.present_family_index = i;
@@ -755,15 +1832,22 @@ namespace jvsc {
 
 	VkPresentModeKHR JvscRenderer::choose_present_mode(const std::vector<VkPresentModeKHR>& available_present_modes)
 	{
+		VkPresentModeKHR requested = VK_PRESENT_MODE_FIFO_KHR;
+		switch (m_requested_present_mode)
+		{
+		case PresentMode::Fifo: requested = VK_PRESENT_MODE_FIFO_KHR; break;
+		case PresentMode::FifoRelaxed: requested = VK_PRESENT_MODE_FIFO_RELAXED_KHR; break;
+		case PresentMode::Mailbox: requested = VK_PRESENT_MODE_MAILBOX_KHR; break;
+		case PresentMode::Immediate: requested = VK_PRESENT_MODE_IMMEDIATE_KHR; break;
+		}
+
 		for (const auto& available_present_mode : available_present_modes) {
-			if (available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR) 
-			{
-				// std::cout << "Present mode: Mailbox" << std::endl;
+			if (available_present_mode == requested) 
 				return available_present_mode;
-			}
 		}
 
-		// std::cout << "Present mode: V-Sync" << std::endl;
+		// FIFO is the one mode every surface supports
+		std::cout << "requested present mode is not supported, falling back to FIFO" << '\n';
 		return VK_PRESENT_MODE_FIFO_KHR;
 	}
 
@@ -772,7 +1856,7 @@ namespace jvsc {
 		if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max())
 			return capabilities.currentExtent;
 
-		VkExtent2D actualExtent = m_window.get_extent();
+		VkExtent2D actualExtent = m_window->get_extent();
 		actualExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, actualExtent.width));
 		actualExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, actualExtent.height));
 		return actualExtent;
@@ -2,13 +2,23 @@
 
 // lib
 #include "jvsc_window.hpp"
+#include "jvsc_profiler.hpp"
+#include "jvsc_frame_pacer.hpp"
 #include <vma/vk_mem_alloc.h>
 
 // std
+#include <deque>
+#include <functional>
+#include <string>
 #include <vector>
 
 namespace jvsc {
 
+	class JvscUploader;
+	class JvscMeshPool;
+	class JvscShaderRegistry;
+	class JvscPipelineRegistry;
+
 	struct SwapChainSupportDetails 
 	{
 		VkSurfaceCapabilitiesKHR capabilities;
@@ -25,34 +35,146 @@ namespace jvsc {
 		bool is_complete() const { return graphics_family_has_value && present_family_has_value; }
 	};
 
+	// a pair of timestamp queries in a frame's pool
+	struct GpuTimestampScope
+	{
+		const char* name;
+		uint32_t begin_query;
+		uint32_t end_query;
+	};
+
+	struct RendererConfig
+	{
+		// more frames in flight trade input latency for CPU/GPU overlap
+		uint32_t max_frames_in_flight = 2;
+		// loaded at startup and written back in terminate(), empty disables persistence
+		std::string pipeline_cache_path = "pipeline_cache.bin";
+		// throughput vs latency vs tearing, see PresentMode; ignored by the headless renderer
+		PresentMode present_mode = PresentMode::Mailbox;
+		// frames per second the renderer paces to, 0 is unlimited
+		float max_fps = 0.f;
+		// starts each frame only once the previous one was presented, see JvscRenderer::pace_frame()
+		bool low_latency = false;
+		// minimum depth precision, the cheapest depth format that has it is used
+		uint32_t depth_bits = 16;
+		// track GPU progress with a timeline semaphore where the device has Vulkan 1.2, fences otherwise
+		bool timeline_semaphores = true;
+		// render without VkRenderPass and VkFramebuffer objects where the device has VK_KHR_dynamic_rendering
+		bool dynamic_rendering = true;
+		// make cull mode, front face, topology and depth state dynamic where the device has VK_EXT_extended_dynamic_state
+		bool extended_dynamic_state = true;
+	};
+
+	// VK_EXT_extended_dynamic_state entry points, all null when the device does not have it
+	struct ExtendedDynamicState
+	{
+		PFN_vkCmdSetCullModeEXT set_cull_mode = nullptr;
+		PFN_vkCmdSetFrontFaceEXT set_front_face = nullptr;
+		PFN_vkCmdSetPrimitiveTopologyEXT set_primitive_topology = nullptr;
+		PFN_vkCmdSetDepthTestEnableEXT set_depth_test_enable = nullptr;
+		PFN_vkCmdSetDepthWriteEnableEXT set_depth_write_enable = nullptr;
+		PFN_vkCmdSetDepthCompareOpEXT set_depth_compare_op = nullptr;
+	};
+
 	class JvscRenderer
 	{
 	public:
 
-		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
 	#ifdef NDEBUG
 			const bool enable_validation_layers = false;
 	#else
 			const bool enable_validation_layers = true;
 	#endif
 
-		JvscRenderer(JvscWindow& window);
+		JvscRenderer(JvscWindow& window, const RendererConfig& config = {});
+		// headless: renders into offscreen images, no window or VkSurfaceKHR required
+		explicit JvscRenderer(VkExtent2D headless_extent, const RendererConfig& config = {});
 		~JvscRenderer() = default;
 		void terminate();
 		
+		// Frame pacing: runs the frame limiter and, in low latency mode, waits until the previous frame
+		// is on screen (VK_KHR_present_wait) or done on the GPU (without it), then stamps the frame's
+		// input time. Call it right before polling input; begin_frame() calls it for frames that did not.
+		void pace_frame();
 		VkCommandBuffer begin_frame();
-		void begin_swapchain_render_pass(VkCommandBuffer cmd);
+		void begin_swapchain_render_pass(VkCommandBuffer cmd, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+		void end_swapchain_render_pass(VkCommandBuffer cmd);
+		// viewport and scissor are dynamic in every pipeline, set them to the full extent in each
+		// command buffer that draws, secondary buffers included, before the first draw
+		void set_swapchain_viewport(VkCommandBuffer cmd) const;
 		void end_frame(VkCommandBuffer cmd);
 		void handle_minimize();
+		// runs destroy once everything submitted so far has finished on the GPU, for objects frames in flight may still use
+		void defer_destruction(std::function<void()> destroy);
+
+		// GPU progress as one value per graphics queue submission, increasing by one each time. Backed by
+		// a timeline semaphore on Vulkan 1.2 devices, by one pooled fence per submission otherwise. Every
+		// submission to the graphics queue goes through submit(), which returns the value that marks it done.
+		uint64_t submit(VkSubmitInfo submit_info);
+		// waits for everything submitted up to value, returns right away when it is already known to be done
+		void wait_for_gpu_value(uint64_t value);
+		// polls the GPU, the highest value known to be done
+		uint64_t completed_gpu_value();
+		bool gpu_value_reached(uint64_t value) { return value <= m_completed_value || value <= completed_gpu_value(); }
+		// waiting for it waits for everything queued so far
+		uint64_t submitted_gpu_value() const { return m_submitted_value; }
+		void read_back_last_frame(std::vector<uint8_t>& pixels);
+
+		// Timestamps around work in the frame's command buffer, outside secondary buffers. Read back
+		// once the frame's fence has signaled and handed to JvscProfiler. Both are no-ops while the
+		// profiler is disabled; begin returns NO_GPU_SCOPE then, or when the frame has used every scope.
+		static constexpr uint32_t MAX_GPU_SCOPES = 32;
+		static constexpr uint32_t NO_GPU_SCOPE = UINT32_MAX;
+		uint32_t begin_gpu_scope(VkCommandBuffer cmd, const char* name);
+		void end_gpu_scope(VkCommandBuffer cmd, uint32_t scope);
+
+		void set_max_fps(float max_fps) { m_frame_pacer.set_max_fps(max_fps); }
+		void set_low_latency(bool low_latency) { m_low_latency = low_latency; }
+
+		// input-to-present latency of the frames seen completed so far, from the time pace_frame() stamped
+		const FrameLatency& latency() const { return m_frame_pacer.latency(); }
 
 		// getters
+		// VK_NULL_HANDLE with dynamic rendering, pipelines are built from the attachment formats then
 		VkRenderPass render_pass() const { return m_render_pass; }
-		VkFramebuffer framebuffer(int index) const { return m_swapchain_framebuffers[index]; }
+		VkFramebuffer framebuffer(uint32_t image_index, uint32_t frame) const { return m_swapchain_framebuffers.empty() ? VK_NULL_HANDLE : m_swapchain_framebuffers[image_index * m_max_frames_in_flight + frame]; }
+		VkFramebuffer current_framebuffer() const { return framebuffer(m_image_index, m_current_frame); }
 		VkExtent2D extent() const { return m_swapchain_extent; }
-		VkCommandBuffer command_buffer(int index) { return m_command_buffers[index]; }
+		uint32_t frame_index() const { return m_current_frame; }
+		uint32_t max_frames_in_flight() const { return m_max_frames_in_flight; }
+		VkCommandBuffer command_buffer(int frame) { return m_command_buffers[frame]; }
 		VkDevice device() const { return m_device; }
 		VmaAllocator allocator() const { return m_allocator; }
+		VkQueue graphics_queue() const { return m_graphics_queue; }
+		uint32_t graphics_family_index() const { return m_graphics_family_index; }
+		JvscUploader& uploader() { return *m_uploader; }
+		JvscMeshPool& mesh_pool() { return *m_mesh_pool; }
+		JvscShaderRegistry& shader_registry() { return *m_shader_registry; }
+		JvscPipelineRegistry& pipeline_registry() { return *m_pipeline_registry; }
+		VkPipelineCache pipeline_cache() const { return m_pipeline_cache; }
+		bool pipeline_cache_warm() const { return m_pipeline_cache_warm; }
+		VkFormat image_format() const { return m_swapchain_image_format; }
+		VkFormat depth_format() const { return m_depth_image_format; }
+		// memory reserved for the depth images, a lazily allocated one may commit less or none of it
+		VkDeviceSize depth_memory_bytes() const { return m_depth_memory_bytes; }
+		bool depth_lazily_allocated() const { return m_depth_lazily_allocated; }
+		bool headless() const { return m_headless; }
+		const VkPhysicalDeviceLimits& limits() const { return properties.limits; }
+		const char* device_name() const { return properties.deviceName; }
+		// multiDrawIndirect and drawIndirectFirstInstance, what IndirectRenderSystem needs
+		bool supports_indirect_draws() const { return m_supports_indirect_draws; }
+		bool supports_timestamps() const { return m_supports_timestamps; }
+		bool uses_timeline_semaphore() const { return m_timeline_semaphore != VK_NULL_HANDLE; }
+		bool uses_dynamic_rendering() const { return m_cmd_begin_rendering != nullptr; }
+		bool supports_extended_dynamic_state() const { return m_extended_dynamic_state.set_cull_mode != nullptr; }
+		const ExtendedDynamicState& extended_dynamic_state() const { return m_extended_dynamic_state; }
+		// VK_KHR_present_id and VK_KHR_present_wait, latency is measured at the fence without them
+		bool supports_present_wait() const { return m_wait_for_present != nullptr; }
+		VkPresentModeKHR present_mode() const { return m_present_mode; }
+		float max_fps() const { return m_frame_pacer.max_fps(); }
+		bool low_latency() const { return m_low_latency; }
+		// VK_KHR_draw_indirect_count, null when the device does not have it
+		PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count() const { return m_draw_indexed_indirect_count; }
 
 
 		JvscRenderer(const JvscRenderer&) = delete;
@@ -67,20 +189,32 @@ namespace jvsc {
 		void select_physical_device();
 		void create_device();
 		void create_allocator();
+		void create_pipeline_cache();
+		void save_pipeline_cache();
+		bool is_pipeline_cache_valid(const std::vector<char>& data) const;
 		void create_swapchain();
+		void recreate_swapchain();
+		void run_deferred_destructions(bool all);
+		void create_offscreen_images();
 		void create_swapchain_image_views();
 		void create_depth_resources();
 		void create_render_pass();
 		void create_framebuffers();
+		void begin_dynamic_rendering(VkCommandBuffer cmd, VkSubpassContents contents);
+		void end_dynamic_rendering(VkCommandBuffer cmd);
 		void create_sync_objects();
 		void create_command_pool();
 		void create_command_buffers();
+		void create_timestamp_queries();
+		void read_gpu_timestamps(uint32_t frame);
+		void track_latency();
 
 		bool is_device_suitable(VkPhysicalDevice device);
 		bool check_device_extension_support(VkPhysicalDevice physical_device);
 		std::vector<const char*> get_required_extensions();
 		void glfw_required_extensions();
 		QueueFamilyIndices find_queue_families(VkPhysicalDevice physical_device);
+		VkFormat choose_depth_format();
 		VkFormat find_supported_format(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 		SwapChainSupportDetails query_swapchain_support(VkPhysicalDevice physical_device);
 		VkSurfaceFormatKHR choose_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats);
@@ -88,41 +222,145 @@ namespace jvsc {
 		VkExtent2D choose_extent(const VkSurfaceCapabilitiesKHR& capabilities);
 		VkResult submit_command_buffers(uint32_t* image_index);
 
-		JvscWindow& m_window;
+		JvscWindow* m_window = nullptr;
+		bool m_headless = false;
+		uint32_t m_max_frames_in_flight;
+		std::string m_pipeline_cache_path;
+		PresentMode m_requested_present_mode;
+		uint32_t m_depth_bits;
+		bool m_timeline_semaphores_allowed;
+		bool m_dynamic_rendering_allowed;
+		bool m_extended_dynamic_state_allowed;
 		VkInstance m_instance;
+		// what create_instance() asked for, 1.2 when the loader has it, 1.0 otherwise
+		uint32_t m_api_version = VK_API_VERSION_1_0;
+		bool m_has_physical_device_properties2 = false;
 		VkDebugUtilsMessengerEXT m_debug_messenger;
-		VkSurfaceKHR m_surface;
-		VkPhysicalDevice m_physical_device;
+		VkSurfaceKHR m_surface = VK_NULL_HANDLE;
+		VkPhysicalDevice m_physical_device = VK_NULL_HANDLE;
 		VkPhysicalDeviceProperties properties;
 		VkDevice m_device;
+		bool m_supports_indirect_draws = false;
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_draw_indexed_indirect_count = nullptr;
+		PFN_vkWaitForPresentKHR m_wait_for_present = nullptr;
+		PFN_vkWaitSemaphores m_wait_semaphores = nullptr;
+		PFN_vkGetSemaphoreCounterValue m_get_semaphore_counter_value = nullptr;
+		PFN_vkCmdBeginRenderingKHR m_cmd_begin_rendering = nullptr;
+		PFN_vkCmdEndRenderingKHR m_cmd_end_rendering = nullptr;
+		ExtendedDynamicState m_extended_dynamic_state{};
 		uint32_t m_graphics_family_index;
 		VkQueue m_graphics_queue;
 		uint32_t m_present_family_index;
 		VkQueue m_present_queue;
 		VmaAllocator m_allocator;
+		JvscUploader* m_uploader = nullptr;
+		JvscMeshPool* m_mesh_pool = nullptr;
+		JvscShaderRegistry* m_shader_registry = nullptr;
+		JvscPipelineRegistry* m_pipeline_registry = nullptr;
+		VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+		bool m_pipeline_cache_warm = false;
 		VkCommandPool m_command_pool;
+		std::vector<VkCommandPool> m_frame_command_pools;
 		VkSwapchainKHR m_swapchain;
-		VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE;
+		VkSwapchainKHR m_old_swapchain = VK_NULL_HANDLE;
 		std::vector<VkImage> m_swapchain_images;
+		std::vector<VmaAllocation> m_offscreen_image_allocations;
 		std::vector<VkImageView> m_swapchain_image_views;
 		VkFormat m_swapchain_image_format;
 		VkExtent2D m_swapchain_extent;
+		VkPresentModeKHR m_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+		// one per frame slot, not per swapchain image
 		std::vector<VkImage> m_depth_images;
 		std::vector<VmaAllocation> m_depth_image_allocations;
 		std::vector<VkImageView> m_depth_image_views;
 		VkFormat m_depth_image_format;
-		VkRenderPass m_render_pass;
+		VkDeviceSize m_depth_memory_bytes = 0;
+		bool m_depth_lazily_allocated = false;
+		VkRenderPass m_render_pass = VK_NULL_HANDLE;
+		// empty with dynamic rendering
 		std::vector<VkFramebuffer> m_swapchain_framebuffers;
 		std::vector<VkSemaphore> m_image_available_semaphores;
 		std::vector<VkSemaphore> m_render_finished_semaphores;
-		std::vector<VkFence> m_in_flight_fences;
-		std::vector<VkFence> m_images_in_flight;
+		// GPU value of the last frame submitted from each slot and rendered to each image, 0 when none
+		std::vector<uint64_t> m_frame_values;
+		std::vector<uint64_t> m_image_values;
+
+		// signaled with each submission's value, VK_NULL_HANDLE in fence mode
+		VkSemaphore m_timeline_semaphore = VK_NULL_HANDLE;
+		struct PendingFence
+		{
+			uint64_t value;
+			VkFence fence;
+		};
+		// fence mode: one per submission not yet known done, in submission order
+		std::deque<PendingFence> m_pending_fences;
+		std::vector<VkFence> m_free_fences;
+		uint64_t m_submitted_value = 0;
+		uint64_t m_completed_value = 0;
+		std::vector<VkSemaphore> m_submit_signal_semaphores;
+		std::vector<uint64_t> m_submit_signal_values;
 		std::vector<VkCommandBuffer> m_command_buffers;
+		bool m_supports_timestamps = false;
+		float m_timestamp_period = 1.f;
+		uint64_t m_timestamp_mask = 0;
+		std::vector<VkQueryPool> m_timestamp_pools;
+		std::vector<uint32_t> m_timestamp_query_counts;
+		std::vector<std::vector<GpuTimestampScope>> m_gpu_scopes;
+		// CPU time each frame was submitted, where its GPU scopes are placed in the trace
+		std::vector<uint64_t> m_frame_submit_ns;
+		bool m_timing_frame = false;
+		uint32_t m_frame_scope = NO_GPU_SCOPE;
+		uint32_t m_render_pass_scope = NO_GPU_SCOPE;
+		JvscFramePacer m_frame_pacer;
+		bool m_low_latency = false;
+		bool m_frame_paced = false;
+		uint64_t m_frame_input_ns = 0;
+		// submitted frame count, doubles as the present id (ids start at 1)
+		uint64_t m_frame_counter = 0;
+		// last present id queued on the swapchain, 0 when the last present failed
+		uint64_t m_present_id = 0;
+		// m_frame_counter of the frame each slot holds, its completion ends the latency sample without present_wait
+		std::vector<uint64_t> m_frame_ids;
+
+		struct DeferredDestruction
+		{
+			// submitted GPU value when it was deferred, safe once that value is reached
+			uint64_t gpu_value;
+			std::function<void()> destroy;
+		};
+		std::deque<DeferredDestruction> m_deferred_destructions;
 		uint32_t m_current_frame = 0;
 		uint32_t m_image_index = 0;
+		uint32_t m_last_image_index = 0;
 
 		const std::vector<const char*> validation_layers = { "VK_LAYER_KHRONOS_validation" };
-		const std::vector<const char*> device_extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		std::vector<const char*> device_extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	};
+
+	// times the enclosing block on the GPU, see JVSC_PROFILE_GPU_SCOPE
+	class GpuProfileScope
+	{
+	public:
+
+		GpuProfileScope(JvscRenderer& renderer, VkCommandBuffer cmd, const char* name)
+			: m_renderer{renderer}
+			, m_cmd{cmd}
+			, m_scope{renderer.begin_gpu_scope(cmd, name)}
+		{
+		}
+
+		~GpuProfileScope() { m_renderer.end_gpu_scope(m_cmd, m_scope); }
+
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+	private:
+
+		JvscRenderer& m_renderer;
+		VkCommandBuffer m_cmd;
+		uint32_t m_scope;
 	};
 
-}
\ No newline at end of file
+}
+
+#define JVSC_PROFILE_GPU_SCOPE(renderer, cmd, name) ::jvsc::GpuProfileScope JVSC_PROFILE_CONCAT(jvsc_gpu_profile_scope_, __LINE__){ renderer, cmd, name }
\ No newline at end of file
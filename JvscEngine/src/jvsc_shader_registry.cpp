@@ -0,0 +1,189 @@
+#include "jvsc_shader_registry.hpp"
+
+// std
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+// platform
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace jvsc {
+
+	// read-only view of a whole file, unmapped when it goes out of scope
+	class JvscShaderRegistry::MappedFile
+	{
+	public:
+
+		explicit MappedFile(const std::string& filepath)
+		{
+		#ifdef _WIN32
+			m_file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+				throw std::runtime_error("failed to open file: " + filepath);
+
+			LARGE_INTEGER file_size;
+			GetFileSizeEx(m_file, &file_size);
+			m_size = static_cast<size_t>(file_size.QuadPart);
+			if (m_size == 0)
+				return;
+
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_mapping)
+				m_data = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		#else
+			m_file = open(filepath.c_str(), O_RDONLY);
+			if (m_file < 0)
+				throw std::runtime_error("failed to open file: " + filepath);
+
+			struct stat file_stat;
+			fstat(m_file, &file_stat);
+			m_size = static_cast<size_t>(file_stat.st_size);
+			if (m_size == 0)
+				return;
+
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+			m_data = data == MAP_FAILED ? nullptr : data;
+		#endif
+			if (!m_data)
+			{
+				close_file();
+				throw std::runtime_error("failed to map file: " + filepath);
+			}
+		}
+
+		~MappedFile() { close_file(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const void* data() const { return m_data; }
+		size_t size() const { return m_size; }
+
+	private:
+
+		void close_file()
+		{
+		#ifdef _WIN32
+			if (m_data)
+				UnmapViewOfFile(m_data);
+			if (m_mapping)
+				CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE)
+				CloseHandle(m_file);
+			m_mapping = nullptr;
+			m_file = INVALID_HANDLE_VALUE;
+		#else
+			if (m_data)
+				munmap(m_data, m_size);
+			if (m_file >= 0)
+				close(m_file);
+			m_file = -1;
+		#endif
+			m_data = nullptr;
+		}
+
+	#ifdef _WIN32
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+	#else
+		int m_file = -1;
+	#endif
+		void* m_data = nullptr;
+		size_t m_size = 0;
+	};
+
+	JvscShaderRegistry::JvscShaderRegistry(JvscRenderer& renderer)
+		: m_renderer{renderer}
+	{
+		std::cout << "calling shader registry constructor" << '\n';
+	}
+
+	JvscShaderRegistry::~JvscShaderRegistry() = default;
+
+	void JvscShaderRegistry::terminate()
+	{
+		std::cout << "calling shader registry destructor" << '\n';
+
+		for (VkShaderModule module : m_modules)
+			vkDestroyShaderModule(m_renderer.device(), module, nullptr);
+
+		m_modules.clear();
+		m_modules_by_hash.clear();
+		m_modules_by_path.clear();
+		m_files.clear();
+	}
+
+	VkShaderModule JvscShaderRegistry::load(const std::string& filepath)
+	{
+		auto it = m_modules_by_path.find(filepath);
+		if (it != m_modules_by_path.end())
+			return it->second;
+
+		// the mapping is page aligned, so it can be handed to the driver as uint32_t words directly
+		auto file = std::make_unique<MappedFile>(filepath);
+		if (file->size() == 0 || file->size() % sizeof(uint32_t) != 0)
+			throw std::runtime_error("invalid SPIR-V file: " + filepath);
+
+		size_t module_count = m_modules.size();
+		VkShaderModule module = load(static_cast<const uint32_t*>(file->data()), file->size());
+		m_modules_by_path.emplace(filepath, module);
+
+		// a new module compares against this mapping from now on, a reused one never looks at it
+		if (m_modules.size() != module_count)
+			m_files.push_back(std::move(file));
+		return module;
+	}
+
+	VkShaderModule JvscShaderRegistry::load(const uint32_t* code, size_t size)
+	{
+		uint64_t hash = hash_code(code, size);
+
+		std::vector<ModuleEntry>& entries = m_modules_by_hash[hash];
+		for (const ModuleEntry& entry : entries)
+		{
+			if (entry.size == size && std::memcmp(entry.code, code, size) == 0)
+				return entry.module;
+		}
+
+		VkShaderModuleCreateInfo create_info{};
+		create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		create_info.codeSize = size;
+		create_info.pCode = code;
+
+		VkShaderModule module;
+		if (vkCreateShaderModule(m_renderer.device(), &create_info, nullptr, &module) != VK_SUCCESS)
+			throw std::runtime_error("failed to create shader module");
+
+		m_modules.push_back(module);
+		entries.push_back(ModuleEntry{ module, code, size });
+		return module;
+	}
+
+	uint64_t JvscShaderRegistry::hash_code(const void* code, size_t size)
+	{
+		// FNV-1a, one SPIR-V word at a time
+		const uint32_t* words = static_cast<const uint32_t*>(code);
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size / sizeof(uint32_t); i++)
+		{
+			hash ^= words[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+}
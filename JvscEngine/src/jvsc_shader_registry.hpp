@@ -0,0 +1,61 @@
+#pragma once
+
+// lib
+#include "jvsc_renderer.hpp"
+
+// std
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace jvsc {
+
+	// Owns every VkShaderModule. SPIR-V files are memory-mapped rather than read into the heap,
+	// and modules are keyed by a hash of their contents so pipelines sharing a shader share
+	// one module. A hash match is only reused when the code is identical, compared against the
+	// mapping (kept open) or the embedded words, so a module handle stands for its exact SPIR-V.
+	// Modules and mappings live until terminate().
+	class JvscShaderRegistry
+	{
+	public:
+
+		JvscShaderRegistry(JvscRenderer& renderer);
+		~JvscShaderRegistry();
+		void terminate();
+
+		JvscShaderRegistry(const JvscShaderRegistry&) = delete;
+		JvscShaderRegistry& operator=(const JvscShaderRegistry&) = delete;
+
+		// SPIR-V on disk, only mapped the first time a path is requested
+		VkShaderModule load(const std::string& filepath);
+
+		// SPIR-V embedded in the binary, size in bytes, the words must outlive the registry
+		VkShaderModule load(const uint32_t* code, size_t size);
+
+		size_t module_count() const { return m_modules.size(); }
+
+	private:
+
+		class MappedFile;
+
+		struct ModuleEntry
+		{
+			VkShaderModule module;
+			// points into a mapping in m_files or at embedded code, tells apart a hash collision
+			const uint32_t* code;
+			size_t size;
+		};
+
+		static uint64_t hash_code(const void* code, size_t size);
+
+		JvscRenderer& m_renderer;
+
+		std::vector<VkShaderModule> m_modules;
+		std::vector<std::unique_ptr<MappedFile>> m_files;
+		std::unordered_map<std::string, VkShaderModule> m_modules_by_path;
+		// every module with that hash, more than one only on a collision
+		std::unordered_map<uint64_t, std::vector<ModuleEntry>> m_modules_by_hash;
+	};
+
+}
@@ -0,0 +1,214 @@
+#include "jvsc_uploader.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace jvsc {
+
+	static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+	JvscUploader::JvscUploader(JvscRenderer& renderer, VkDeviceSize staging_size)
+		: m_renderer{renderer}
+		, m_staging_size{staging_size}
+	{
+		std::cout << "calling uploader constructor" << '\n';
+
+		create_staging_buffer();
+		create_command_pool();
+	}
+
+	void JvscUploader::terminate()
+	{
+		std::cout << "calling uploader destructor" << '\n';
+
+		wait_idle();
+		m_free_submissions.clear();
+
+		vkDestroyCommandPool(m_renderer.device(), m_command_pool, nullptr);
+		vmaDestroyBuffer(m_renderer.allocator(), m_staging_buffer, m_staging_allocation);
+	}
+
+	void JvscUploader::upload_buffer(VkBuffer dst_buffer, VkDeviceSize dst_offset, const void* data, VkDeviceSize size)
+	{
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+
+		// uploads larger than the ring are split into ring-sized chunks
+		while (size > 0)
+		{
+			VkDeviceSize chunk = std::min(size, m_staging_size);
+			VkDeviceSize staging_offset = allocate_staging(chunk);
+
+			memcpy(m_staging_data + staging_offset, src, static_cast<size_t>(chunk));
+
+			VkBufferCopy region{};
+			region.srcOffset = staging_offset;
+			region.dstOffset = dst_offset;
+			region.size = chunk;
+			m_pending.push_back({ dst_buffer, region });
+
+			src += chunk;
+			dst_offset += chunk;
+			size -= chunk;
+		}
+	}
+
+	void JvscUploader::flush()
+	{
+		retire_submissions(false);
+
+		if (m_pending.empty())
+			return;
+
+		Submission submission{};
+		if (!m_free_submissions.empty())
+		{
+			submission = m_free_submissions.back();
+			m_free_submissions.pop_back();
+			vkResetCommandBuffer(submission.cmd, 0);
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo alloc_info{};
+			alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			alloc_info.commandPool = m_command_pool;
+			alloc_info.commandBufferCount = 1;
+			if (vkAllocateCommandBuffers(m_renderer.device(), &alloc_info, &submission.cmd) != VK_SUCCESS)
+				throw std::runtime_error("failed to allocate upload command buffer");
+		}
+
+		vmaFlushAllocation(m_renderer.allocator(), m_staging_allocation, 0, VK_WHOLE_SIZE);
+
+		VkCommandBufferBeginInfo begin_info{};
+		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(submission.cmd, &begin_info);
+
+		// earlier frames may still be reading the ranges about to be overwritten, buffers updated in place need this
+		vkCmdPipelineBarrier(submission.cmd, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+		for (const auto& copy : m_pending)
+			vkCmdCopyBuffer(submission.cmd, m_staging_buffer, copy.dst_buffer, 1, &copy.region);
+
+		// make the copies visible to every later submission on this queue that reads geometry or buffers
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT;
+		vkCmdPipelineBarrier(submission.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		if (vkEndCommandBuffer(submission.cmd) != VK_SUCCESS)
+			throw std::runtime_error("failed to record upload command buffer");
+
+		VkSubmitInfo submit_info{};
+		submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submit_info.commandBufferCount = 1;
+		submit_info.pCommandBuffers = &submission.cmd;
+
+		submission.gpu_value = m_renderer.submit(submit_info);
+		submission.ring_end = m_head;
+		m_in_flight.push_back(submission);
+		m_pending.clear();
+	}
+
+	void JvscUploader::wait_idle()
+	{
+		flush();
+		while (!m_in_flight.empty())
+			retire_submissions(true);
+	}
+
+	void JvscUploader::create_staging_buffer()
+	{
+		VkBufferCreateInfo buffer_info{};
+		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size = m_staging_size;
+		buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo alloc_info{};
+		alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+		alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+		VmaAllocationInfo allocation_info;
+		if (vmaCreateBuffer(m_renderer.allocator(), &buffer_info, &alloc_info, &m_staging_buffer, &m_staging_allocation, &allocation_info) != VK_SUCCESS)
+			throw std::runtime_error("failed to create staging buffer");
+
+		m_staging_data = static_cast<uint8_t*>(allocation_info.pMappedData);
+	}
+
+	void JvscUploader::create_command_pool()
+	{
+		VkCommandPoolCreateInfo pool_info = {};
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.queueFamilyIndex = m_renderer.graphics_family_index();
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+		if (vkCreateCommandPool(m_renderer.device(), &pool_info, nullptr, &m_command_pool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	VkDeviceSize JvscUploader::allocate_staging(VkDeviceSize size)
+	{
+		size = (size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+		size = std::min(size, m_staging_size);
+
+		while (true)
+		{
+			if (m_ring_empty)
+			{
+				m_head = 0;
+				m_tail = 0;
+			}
+
+			if (m_ring_empty || m_head > m_tail)
+			{
+				// free space is [m_head, end) followed by [0, m_tail)
+				if (m_head + size <= m_staging_size)
+				{
+					VkDeviceSize offset = m_head;
+					m_head += size;
+					m_ring_empty = false;
+					return offset;
+				}
+				if (size <= m_tail)
+				{
+					m_head = size;
+					return 0;
+				}
+			}
+			else if (m_head + size <= m_tail)
+			{
+				// wrapped: free space is [m_head, m_tail)
+				VkDeviceSize offset = m_head;
+				m_head += size;
+				return offset;
+			}
+
+			// out of space: submit what is staged so far and reclaim the oldest batch
+			flush();
+			retire_submissions(true);
+		}
+	}
+
+	void JvscUploader::retire_submissions(bool wait_for_oldest)
+	{
+		if (wait_for_oldest && !m_in_flight.empty())
+			m_renderer.wait_for_gpu_value(m_in_flight.front().gpu_value);
+
+		while (!m_in_flight.empty() && m_renderer.gpu_value_reached(m_in_flight.front().gpu_value))
+		{
+			m_tail = m_in_flight.front().ring_end;
+			m_free_submissions.push_back(m_in_flight.front());
+			m_in_flight.pop_front();
+		}
+
+		if (m_in_flight.empty() && m_pending.empty())
+			m_ring_empty = true;
+	}
+
+}
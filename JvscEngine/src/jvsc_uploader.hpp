@@ -0,0 +1,78 @@
+#pragma once
+
+// lib
+#include "jvsc_renderer.hpp"
+
+// std
+#include <deque>
+#include <vector>
+
+namespace jvsc {
+
+	// Copies host data into device-local buffers through a persistently mapped staging ring.
+	// Copies are batched until flush(), which records them into a single transfer submission
+	// tracked by its JvscRenderer GPU value. Ring space is reclaimed as those values are reached. Not thread safe.
+	class JvscUploader
+	{
+	public:
+
+		static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 16 * 1024 * 1024;
+
+		JvscUploader(JvscRenderer& renderer, VkDeviceSize staging_size = DEFAULT_STAGING_SIZE);
+		~JvscUploader() = default;
+		void terminate();
+
+		JvscUploader(const JvscUploader&) = delete;
+		JvscUploader& operator=(const JvscUploader&) = delete;
+
+		// data is copied into the staging ring immediately, the GPU copy happens on the next flush()
+		void upload_buffer(VkBuffer dst_buffer, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
+
+		// submits every pending copy as one batch, does not wait for completion
+		void flush();
+
+		// blocks until every submitted copy has completed
+		void wait_idle();
+
+		bool has_pending() const { return !m_pending.empty(); }
+
+	private:
+
+		struct PendingCopy
+		{
+			VkBuffer dst_buffer;
+			VkBufferCopy region;
+		};
+
+		struct Submission
+		{
+			uint64_t gpu_value;
+			VkCommandBuffer cmd;
+			VkDeviceSize ring_end;
+		};
+
+		void create_staging_buffer();
+		void create_command_pool();
+
+		VkDeviceSize allocate_staging(VkDeviceSize size);
+		void retire_submissions(bool wait_for_oldest);
+
+		JvscRenderer& m_renderer;
+
+		VkBuffer m_staging_buffer;
+		VmaAllocation m_staging_allocation;
+		uint8_t* m_staging_data;
+		VkDeviceSize m_staging_size;
+
+		// live ring range is [m_tail, m_head), wrapping at m_staging_size
+		VkDeviceSize m_head = 0;
+		VkDeviceSize m_tail = 0;
+		bool m_ring_empty = true;
+
+		VkCommandPool m_command_pool;
+		std::vector<PendingCopy> m_pending;
+		std::deque<Submission> m_in_flight;
+		std::vector<Submission> m_free_submissions;
+	};
+
+}
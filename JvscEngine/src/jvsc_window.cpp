@@ -53,12 +53,21 @@ namespace jvsc {
 			throw std::runtime_error("glfw init failed");
 
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 		m_window = glfwCreateWindow(width, height, name.c_str(), nullptr, nullptr);
 
 		if (!m_window)
 			throw std::runtime_error("window creation failed");
 		
 		glfwSetWindowUserPointer(m_window, this);
+		glfwSetFramebufferSizeCallback(m_window, framebuffer_resize_callback);
+	}
+
+	void JvscWindow::framebuffer_resize_callback(GLFWwindow* window, int width, int height)
+	{
+		auto jvsc_window = reinterpret_cast<JvscWindow*>(glfwGetWindowUserPointer(window));
+		jvsc_window->m_framebuffer_resized = true;
+		jvsc_window->m_width = width;
+		jvsc_window->m_height = height;
 	}
 }
\ No newline at end of file
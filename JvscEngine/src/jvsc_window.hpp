@@ -23,6 +23,9 @@ namespace jvsc {
 		GLFWwindow* handle() { return m_window; }
 		bool should_close() { return glfwWindowShouldClose(m_window); };
 		VkExtent2D get_extent() { return { static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height) }; }
+		// set by the framebuffer size callback until the renderer has recreated its swapchain
+		bool was_resized() const { return m_framebuffer_resized; }
+		void reset_resized_flag() { m_framebuffer_resized = false; }
 		void create_surface(VkInstance instance, VkSurfaceKHR* surface);
 
 
@@ -36,10 +39,12 @@ namespace jvsc {
 		static JvscWindow* s_instance;
 
 		void init(int width, int height, const std::string& name);
+		static void framebuffer_resize_callback(GLFWwindow* window, int width, int height);
 
 		GLFWwindow* m_window;
 
 		int m_width, m_height;
+		bool m_framebuffer_resized = false;
 
 		std::string m_name;
 	};
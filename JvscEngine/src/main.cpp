@@ -1,9 +1,87 @@
 #include "first_app.hpp"
 
+// std
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
 
-int main()
+namespace {
+
+	// digits only, stoul alone takes "-1" and "3x"; up to 9 of them always fit
+	uint32_t parse_count(const std::string& arg, const std::string& value)
+	{
+		bool digits = !value.empty() && value.find_first_not_of("0123456789") == std::string::npos;
+		if (!digits || value.size() > 9)
+			throw std::runtime_error("invalid value for " + arg + ": " + value);
+		return static_cast<uint32_t>(std::stoul(value));
+	}
+
+	// 0 turns the limiter off, any other limit must be at least 1
+	float parse_fps(const std::string& arg, const std::string& value)
+	{
+		size_t parsed = 0;
+		float fps = -1.f;
+		try
+		{
+			fps = std::stof(value, &parsed);
+		}
+		catch (const std::exception&)
+		{
+			parsed = 0;
+		}
+		// the comparisons are false for NaN
+		bool valid = parsed > 0 && parsed == value.size() && std::isfinite(fps) && (fps == 0.f || fps >= 1.f);
+		if (!valid)
+			throw std::runtime_error("invalid value for " + arg + ": " + value);
+		return fps;
+	}
+
+}
+
+int main(int argc, char** argv)
 {
-	FirstApp app;
+	jvsc::RendererConfig config{};
+	std::string trace_path;
+
+	try
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			if (arg == "--frames-in-flight" && i + 1 < argc)
+				config.max_frames_in_flight = parse_count(arg, argv[++i]);
+			else if (arg == "--profile" && i + 1 < argc)
+				trace_path = argv[++i];
+			else if (arg == "--max-fps" && i + 1 < argc)
+				config.max_fps = parse_fps(arg, argv[++i]);
+			else if (arg == "--low-latency")
+				config.low_latency = true;
+			else if (arg == "--present-mode" && i + 1 < argc)
+			{
+				std::string mode = argv[++i];
+				if (mode == "fifo")
+					config.present_mode = jvsc::PresentMode::Fifo;
+				else if (mode == "fifo-relaxed")
+					config.present_mode = jvsc::PresentMode::FifoRelaxed;
+				else if (mode == "mailbox")
+					config.present_mode = jvsc::PresentMode::Mailbox;
+				else if (mode == "immediate")
+					config.present_mode = jvsc::PresentMode::Immediate;
+				else
+					throw std::runtime_error("unknown present mode " + mode + ", expected fifo, fifo-relaxed, mailbox or immediate");
+			}
+		}
+	}
+	catch (const std::exception& error)
+	{
+		std::cerr << error.what() << '\n';
+		return 2;
+	}
+
+	FirstApp app{ config };
+	if (!trace_path.empty())
+		app.enable_profiling(trace_path);
 
 	try
 	{
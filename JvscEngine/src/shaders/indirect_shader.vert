@@ -0,0 +1,36 @@
+#version 460
+
+layout (location = 0) in vec2 inPosition;
+layout (location = 1) in vec3 inColor;
+
+struct ObjectData
+{
+	vec4 transform;	// mat2 columns, xy and zw
+	vec4 color;
+	vec2 offset;
+	uint mesh;
+	uint padding;
+};
+
+layout (std430, set = 0, binding = 0) readonly buffer Objects { ObjectData objects[]; };
+
+// debug variant, colors every object by its mesh to check the mesh table
+layout (constant_id = 0) const bool COLOR_BY_MESH = false;
+
+layout (location = 0) out vec3 fragColor;
+
+void main()
+{
+	// cull.comp puts the object index in firstInstance
+	ObjectData object = objects[gl_InstanceIndex];
+	mat2 transform = mat2(object.transform.xy, object.transform.zw);
+	gl_Position = vec4(transform * inPosition + object.offset, 0.0, 1.0);
+	fragColor = object.color.rgb;
+
+	if (COLOR_BY_MESH)
+	{
+		// hashed so neighbouring ids get unrelated colors
+		uint hash = object.mesh * 2654435761u;
+		fragColor = vec3((hash >> 24) & 255u, (hash >> 16) & 255u, (hash >> 8) & 255u) / 255.0;
+	}
+}
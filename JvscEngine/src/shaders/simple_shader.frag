@@ -2,11 +2,10 @@
 
 layout (location = 0) out vec4 outColor;
 
+// only the color is read here, it sits at the same offset as in simple_shader.vert
 layout (push_constant) uniform SimplePushConstants
 {
-	mat2 transform;
-	vec2 offset;
-	vec3 color;
+	layout (offset = 32) vec3 color;
 } push;
 
 void main()
@@ -0,0 +1,19 @@
+#version 460
+
+layout (location = 0) in vec2 inPosition;
+layout (location = 1) in vec3 inColor;
+
+// per instance
+layout (location = 2) in vec2 inTransformCol0;
+layout (location = 3) in vec2 inTransformCol1;
+layout (location = 4) in vec2 inOffset;
+layout (location = 5) in vec3 inInstanceColor;
+
+layout (location = 0) out vec3 fragColor;
+
+void main()
+{
+	mat2 transform = mat2(inTransformCol0, inTransformCol1);
+	gl_Position = vec4(transform * inPosition + inOffset, 0.0, 1.0);
+	fragColor = inInstanceColor;
+}
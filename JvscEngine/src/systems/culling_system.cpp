@@ -0,0 +1,191 @@
+#include "culling_system.hpp"
+
+// lib
+#include "jvsc_profiler.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace jvsc {
+
+	// keeps cell coordinates well inside int32 for objects flung far away
+	constexpr float MAX_CELL_COORDINATE = 1073741824.f;
+
+	CullingSystem::CullingSystem(float cell_size)
+		: m_cell_size{cell_size}
+	{
+		if (cell_size <= 0.f)
+			throw std::runtime_error("culling grid cell size must be positive");
+		m_inverse_cell_size = 1.f / cell_size;
+	}
+
+	void CullingSystem::update(JvscRegistry& registry)
+	{
+		JVSC_PROFILE_SCOPE("CullingSystem::update");
+
+		// same order SimpleRenderSystem packs in, so the indices in m_visible line up with its arrays
+		size_t renderable_count = registry.pack<RenderComponent, WorldTransform2D>();
+		size_t count = registry.pack<RenderComponent, WorldTransform2D, CullingProxy>();
+		if (count < renderable_count)
+		{
+			auto& renderables = registry.pool<RenderComponent>();
+			for (size_t i = count; i < renderable_count; i++)
+				registry.add<CullingProxy>(renderables.entity_at(i));
+			count = registry.pack<RenderComponent, WorldTransform2D, CullingProxy>();
+		}
+
+		auto& proxy_pool = registry.pool<CullingProxy>();
+		const RenderComponent* renderables = registry.pool<RenderComponent>().data();
+		const WorldTransform2D* transforms = registry.pool<WorldTransform2D>().data();
+		CullingProxy* proxies = proxy_pool.data();
+		const Entity* entities = proxy_pool.entities();
+
+		m_moved_count = 0;
+		glm::vec2 max_half_extent{ 0.f };
+		for (size_t i = 0; i < count; i++)
+		{
+			const MeshBounds& bounds = renderables[i].mesh->bounds();
+			const glm::mat2& matrix = transforms[i].matrix;
+			CullingProxy& proxy = proxies[i];
+
+			// bounds of the transformed box: the center goes through the matrix, the extent through its absolute value
+			glm::vec2 local_center = (bounds.min + bounds.max) * 0.5f;
+			glm::vec2 local_half_extent = (bounds.max - bounds.min) * 0.5f;
+			proxy.center = matrix * local_center + transforms[i].offset;
+			proxy.half_extent.x = std::abs(matrix[0][0]) * local_half_extent.x + std::abs(matrix[1][0]) * local_half_extent.y;
+			proxy.half_extent.y = std::abs(matrix[0][1]) * local_half_extent.x + std::abs(matrix[1][1]) * local_half_extent.y;
+			max_half_extent = glm::max(max_half_extent, proxy.half_extent);
+
+			uint64_t cell = cell_of(proxy.center);
+			if (proxy.in_grid && proxy.cell == cell)
+				continue;
+
+			if (proxy.in_grid)
+				remove(proxy_pool, proxy);
+			insert(entities[i], proxy, cell);
+			m_moved_count++;
+		}
+		m_max_half_extent = max_half_extent;
+
+		query(registry);
+	}
+
+	void CullingSystem::query(JvscRegistry& registry)
+	{
+		m_visible.clear();
+		m_tested_count = 0;
+
+		glm::vec2 query_min = m_view_min - m_max_half_extent;
+		glm::vec2 query_max = m_view_max + m_max_half_extent;
+		int32_t min_x = cell_coordinate(query_min.x);
+		int32_t min_y = cell_coordinate(query_min.y);
+		int32_t max_x = cell_coordinate(query_max.x);
+		int32_t max_y = cell_coordinate(query_max.y);
+
+		// zoomed far out it is cheaper to walk the occupied cells than the covered ones
+		uint64_t covered = static_cast<uint64_t>(max_x - min_x + 1) * static_cast<uint64_t>(max_y - min_y + 1);
+		if (covered > m_cells.size())
+		{
+			for (auto& [key, entities] : m_cells)
+			{
+				int32_t x = static_cast<int32_t>(static_cast<uint32_t>(key >> 32));
+				int32_t y = static_cast<int32_t>(static_cast<uint32_t>(key));
+				if (x >= min_x && x <= max_x && y >= min_y && y <= max_y)
+					query_cell(registry, entities);
+			}
+		}
+		else
+		{
+			for (int32_t y = min_y; y <= max_y; y++)
+			{
+				for (int32_t x = min_x; x <= max_x; x++)
+				{
+					auto it = m_cells.find(cell_key(x, y));
+					if (it != m_cells.end())
+						query_cell(registry, it->second);
+				}
+			}
+		}
+
+		// cells hand objects back in no particular order, draw them in pool order
+		std::sort(m_visible.begin(), m_visible.end());
+	}
+
+	void CullingSystem::query_cell(JvscRegistry& registry, std::vector<Entity>& entities)
+	{
+		auto& proxies = registry.pool<CullingProxy>();
+		auto& renderables = registry.pool<RenderComponent>();
+		auto& transforms = registry.pool<WorldTransform2D>();
+
+		uint32_t i = 0;
+		while (i < entities.size())
+		{
+			Entity entity = entities[i];
+			CullingProxy* proxy = proxies.try_get(entity);
+
+			// destroyed, or no longer drawable: drop it from the grid now that we came across it
+			if (!proxy || !renderables.contains(entity) || !transforms.contains(entity))
+			{
+				remove_at(proxies, entities, i);
+				if (proxy)
+					proxies.remove(entity);
+				continue;
+			}
+
+			m_tested_count++;
+			if (std::abs(proxy->center.x - (m_view_min.x + m_view_max.x) * 0.5f) <= proxy->half_extent.x + (m_view_max.x - m_view_min.x) * 0.5f &&
+				std::abs(proxy->center.y - (m_view_min.y + m_view_max.y) * 0.5f) <= proxy->half_extent.y + (m_view_max.y - m_view_min.y) * 0.5f)
+				m_visible.push_back(static_cast<uint32_t>(renderables.index_of(entity)));
+			i++;
+		}
+	}
+
+	void CullingSystem::insert(Entity entity, CullingProxy& proxy, uint64_t cell)
+	{
+		std::vector<Entity>& entities = m_cells[cell];
+		proxy.cell = cell;
+		proxy.index_in_cell = static_cast<uint32_t>(entities.size());
+		proxy.in_grid = true;
+		entities.push_back(entity);
+	}
+
+	void CullingSystem::remove(ComponentPool<CullingProxy>& proxies, CullingProxy& proxy)
+	{
+		auto it = m_cells.find(proxy.cell);
+		if (it != m_cells.end())
+		{
+			remove_at(proxies, it->second, proxy.index_in_cell);
+			if (it->second.empty())
+				m_cells.erase(it);
+		}
+		proxy.in_grid = false;
+	}
+
+	void CullingSystem::remove_at(ComponentPool<CullingProxy>& proxies, std::vector<Entity>& entities, uint32_t index)
+	{
+		// swap with the last entry, whose proxy then needs its new slot
+		Entity moved = entities.back();
+		entities[index] = moved;
+		entities.pop_back();
+
+		if (index < entities.size())
+		{
+			if (CullingProxy* moved_proxy = proxies.try_get(moved))
+				moved_proxy->index_in_cell = index;
+		}
+	}
+
+	uint64_t CullingSystem::cell_of(glm::vec2 position) const
+	{
+		return cell_key(cell_coordinate(position.x), cell_coordinate(position.y));
+	}
+
+	int32_t CullingSystem::cell_coordinate(float value) const
+	{
+		float cell = std::floor(value * m_inverse_cell_size);
+		return static_cast<int32_t>(std::clamp(cell, -MAX_CELL_COORDINATE, MAX_CELL_COORDINATE));
+	}
+
+}
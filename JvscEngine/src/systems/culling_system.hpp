@@ -0,0 +1,82 @@
+#pragma once
+
+// lib
+#include "jvsc_mesh.hpp"
+#include "jvsc_components.hpp"
+#include "jvsc_registry.hpp"
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace jvsc {
+
+	// an entity's place in CullingSystem's grid and its world bounds as of the last update
+	struct CullingProxy
+	{
+		glm::vec2 center{ 0.f };
+		glm::vec2 half_extent{ 0.f };
+		uint64_t cell = 0;
+		uint32_t index_in_cell = 0;
+		bool in_grid = false;
+	};
+
+	// Loose uniform grid over the world bounds of everything SimpleRenderSystem draws. An object
+	// lives in the one cell holding its center, so moving only touches the grid when it crosses
+	// into another cell. Queries widen the view by the largest object half extent to catch
+	// objects reaching in from neighbouring cells. Cells are hashed, the world is unbounded.
+	class CullingSystem
+	{
+	public:
+
+		CullingSystem(float cell_size = 0.5f);
+		~CullingSystem() = default;
+
+		// world space rectangle that counts as on screen, the [-1, 1] clip square until there is a camera
+		void set_view(glm::vec2 min, glm::vec2 max) { m_view_min = min; m_view_max = max; }
+
+		// refreshes bounds of every entity with a RenderComponent and a WorldTransform2D, run after TransformSystem
+		void update(JvscRegistry& registry);
+
+		// indices into the packed RenderComponent / WorldTransform2D pools, sorted, for SimpleRenderSystem
+		const std::vector<uint32_t>& visible() const { return m_visible; }
+
+		// objects checked against the view last update, only those in cells near it
+		size_t tested_count() const { return m_tested_count; }
+		size_t visible_count() const { return m_visible.size(); }
+		// objects that changed cell last update
+		size_t moved_count() const { return m_moved_count; }
+		size_t cell_count() const { return m_cells.size(); }
+		float cell_size() const { return m_cell_size; }
+
+	private:
+
+		uint64_t cell_of(glm::vec2 position) const;
+		int32_t cell_coordinate(float value) const;
+		static uint64_t cell_key(int32_t x, int32_t y) { return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y); }
+
+		void insert(Entity entity, CullingProxy& proxy, uint64_t cell);
+		void remove(ComponentPool<CullingProxy>& proxies, CullingProxy& proxy);
+		void remove_at(ComponentPool<CullingProxy>& proxies, std::vector<Entity>& entities, uint32_t index);
+
+		void query(JvscRegistry& registry);
+		void query_cell(JvscRegistry& registry, std::vector<Entity>& entities);
+
+		float m_cell_size;
+		float m_inverse_cell_size;
+
+		glm::vec2 m_view_min{ -1.f };
+		glm::vec2 m_view_max{ 1.f };
+
+		std::unordered_map<uint64_t, std::vector<Entity>> m_cells;
+
+		// how far objects reached out of their cell in the last update
+		glm::vec2 m_max_half_extent{ 0.f };
+
+		std::vector<uint32_t> m_visible;
+		size_t m_tested_count = 0;
+		size_t m_moved_count = 0;
+	};
+
+}
@@ -0,0 +1,478 @@
+#include "indirect_render_system.hpp"
+
+// lib
+#include "jvsc_uploader.hpp"
+#include "jvsc_mesh_pool.hpp"
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+namespace jvsc {
+
+	static_assert(sizeof(GpuObjectData) == 48, "GpuObjectData must match ObjectData in cull.comp");
+	static_assert(sizeof(GpuMeshInfo) == 32, "GpuMeshInfo must match MeshInfo in cull.comp");
+
+	constexpr size_t MIN_OBJECT_CAPACITY = 1024;
+	constexpr uint32_t MIN_MESH_CAPACITY = 64;
+	constexpr VkDeviceSize DRAW_COMMAND_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+
+	IndirectRenderSystem::IndirectRenderSystem(JvscRenderer& renderer, VkRenderPass render_pass)
+		: m_renderer{renderer}
+		, m_draw_indexed_indirect_count{renderer.draw_indexed_indirect_count()}
+	{
+		if (!renderer.supports_indirect_draws())
+			throw std::runtime_error("device does not support multi draw indirect with a first instance");
+
+		create_descriptors();
+		create_pipeline_layout();
+		create_pipelines(render_pass);
+
+		reserve_objects(MIN_OBJECT_CAPACITY, std::max(m_renderer.mesh_pool().block_count(), 1u));
+		reserve_meshes(MIN_MESH_CAPACITY);
+		write_descriptors();
+		m_descriptors_dirty = false;
+	}
+
+	void IndirectRenderSystem::terminate()
+	{
+		destroy_buffer(m_object_buffer, m_object_allocation);
+		destroy_buffer(m_mesh_buffer, m_mesh_allocation);
+		destroy_buffer(m_draw_buffer, m_draw_allocation);
+		destroy_buffer(m_count_buffer, m_count_allocation);
+
+		m_renderer.pipeline_registry().release_layout(m_pipeline_layout);
+		m_cull_pipeline->destroy();
+		delete m_cull_pipeline;
+
+		vkDestroyPipelineLayout(m_renderer.device(), m_pipeline_layout, nullptr);
+		// frees the descriptor set with it
+		vkDestroyDescriptorPool(m_renderer.device(), m_descriptor_pool, nullptr);
+		vkDestroyDescriptorSetLayout(m_renderer.device(), m_set_layout, nullptr);
+	}
+
+	void IndirectRenderSystem::prepare(VkCommandBuffer cmd, JvscRegistry& registry)
+	{
+		JVSC_PROFILE_SCOPE("IndirectRenderSystem::prepare");
+
+		m_block_count = std::max(m_renderer.mesh_pool().block_count(), 1u);
+		sync_objects(registry);
+		size_t count = m_object_count;
+
+		// only after the device went idle for a resize, never while a frame uses the set
+		if (m_descriptors_dirty)
+		{
+			write_descriptors();
+			m_descriptors_dirty = false;
+		}
+
+		// the previous frame may still be drawing from the commands and counts rewritten below
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+		vkCmdFillBuffer(cmd, m_count_buffer, 0, VK_WHOLE_SIZE, 0);
+		if (!m_draw_indexed_indirect_count)
+			vkCmdFillBuffer(cmd, m_draw_buffer, 0, VK_WHOLE_SIZE, 0);
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+		if (count > 0)
+		{
+			JVSC_PROFILE_GPU_SCOPE(m_renderer, cmd, "cull.comp");
+
+			CullPushConstants push{};
+			push.view_min = m_view_min;
+			push.view_max = m_view_max;
+			push.object_count = static_cast<uint32_t>(count);
+			push.draw_capacity = static_cast<uint32_t>(m_object_capacity);
+
+			m_cull_pipeline->bind(cmd);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &m_descriptor_set, 0, nullptr);
+			vkCmdPushConstants(cmd, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+			vkCmdDispatch(cmd, static_cast<uint32_t>((count + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE), 1, 1);
+		}
+
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void IndirectRenderSystem::render(VkCommandBuffer cmd)
+	{
+		m_indirect_draw_count = 0;
+		// the draw pipelines compile in the background, nothing is drawn until one is ready
+		JvscPipeline* pipeline = m_pipeline->get();
+		if (m_color_by_mesh && m_mesh_color_pipeline->ready())
+			pipeline = m_mesh_color_pipeline->get();
+		if (m_object_count == 0 || !pipeline)
+			return;
+
+		pipeline->bind(cmd);
+		m_renderer.set_swapchain_viewport(cmd);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &m_descriptor_set, 0, nullptr);
+
+		size_t max_draws = m_renderer.limits().maxDrawIndirectCount;
+		for (uint32_t block = 0; block < m_block_count; block++)
+		{
+			m_renderer.mesh_pool().bind(cmd, block);
+			VkDeviceSize region = static_cast<VkDeviceSize>(block) * m_object_capacity * DRAW_COMMAND_STRIDE;
+
+			if (m_draw_indexed_indirect_count)
+			{
+				uint32_t draw_count = static_cast<uint32_t>(std::min(m_object_count, max_draws));
+				m_draw_indexed_indirect_count(cmd, m_draw_buffer, region, m_count_buffer, block * sizeof(uint32_t), draw_count, DRAW_COMMAND_STRIDE);
+				m_indirect_draw_count++;
+				continue;
+			}
+
+			// no count to read, so draw every slot an object could have landed in, the zeroed rest draw nothing
+			for (size_t first = 0; first < m_object_count; first += max_draws)
+			{
+				uint32_t draw_count = static_cast<uint32_t>(std::min(m_object_count - first, max_draws));
+				vkCmdDrawIndexedIndirect(cmd, m_draw_buffer, region + first * DRAW_COMMAND_STRIDE, draw_count, DRAW_COMMAND_STRIDE);
+				m_indirect_draw_count++;
+			}
+		}
+	}
+
+	void IndirectRenderSystem::sync_objects(JvscRegistry& registry)
+	{
+		auto& renderables = registry.pool<RenderComponent>();
+		auto& transforms = registry.pool<WorldTransform2D>();
+		renderables.track_changes();
+		transforms.track_changes();
+
+		// an entity can be on both lists, or on one more than once, rebuilding it again is harmless
+		for (Entity entity : renderables.changed())
+			sync_object(renderables, transforms, entity);
+		for (Entity entity : transforms.changed())
+			sync_object(renderables, transforms, entity);
+		renderables.clear_changes();
+		transforms.clear_changes();
+
+		m_object_count = m_slot_entities.size();
+		reserve_objects(m_object_count, m_block_count);
+		upload_objects();
+	}
+
+	void IndirectRenderSystem::sync_object(ComponentPool<RenderComponent>& renderables, ComponentPool<WorldTransform2D>& transforms, Entity entity)
+	{
+		uint32_t index = entity_index(entity);
+		if (index >= m_slot_of.size())
+			m_slot_of.resize(static_cast<size_t>(index) + 1, NO_SLOT);
+
+		uint32_t slot = m_slot_of[index];
+		bool owned = slot != NO_SLOT && m_slot_entities[slot] == entity;
+		if (!renderables.contains(entity) || !transforms.contains(entity))
+		{
+			if (owned)
+				remove_slot(slot);
+			return;
+		}
+
+		// a slot not owned by a live entity with this index belongs to a destroyed one
+		if (slot != NO_SLOT && !owned)
+		{
+			remove_slot(slot);
+			slot = NO_SLOT;
+		}
+		if (slot == NO_SLOT)
+		{
+			slot = static_cast<uint32_t>(m_slot_entities.size());
+			m_slot_of[index] = slot;
+			m_slot_entities.push_back(entity);
+			m_object_shadow.emplace_back();
+		}
+
+		const RenderComponent& renderable = renderables.get(entity);
+		const WorldTransform2D& transform = transforms.get(entity);
+		const glm::mat2& matrix = transform.matrix;
+
+		GpuObjectData& object = m_object_shadow[slot];
+		object.transform = glm::vec4(matrix[0][0], matrix[0][1], matrix[1][0], matrix[1][1]);
+		object.color = glm::vec4(renderable.color, 1.f);
+		object.offset = transform.offset;
+
+		// mesh ids come from a counter and are never reused, the same id means the same mesh
+		uint32_t mesh = renderable.mesh->id();
+		if (mesh != object.mesh)
+		{
+			sync_mesh(renderable.mesh);
+			object.mesh = mesh;
+		}
+
+		mark_slot(slot);
+	}
+
+	void IndirectRenderSystem::remove_slot(uint32_t slot)
+	{
+		uint32_t last = static_cast<uint32_t>(m_slot_entities.size() - 1);
+		m_slot_of[entity_index(m_slot_entities[slot])] = NO_SLOT;
+
+		if (slot != last)
+		{
+			m_slot_entities[slot] = m_slot_entities[last];
+			m_object_shadow[slot] = m_object_shadow[last];
+			m_slot_of[entity_index(m_slot_entities[slot])] = slot;
+			mark_slot(slot);
+		}
+		m_slot_entities.pop_back();
+		m_object_shadow.pop_back();
+	}
+
+	void IndirectRenderSystem::mark_slot(uint32_t slot)
+	{
+		if (slot >= m_slot_dirty.size())
+			m_slot_dirty.resize(static_cast<size_t>(slot) + 1, 0);
+		if (m_slot_dirty[slot])
+			return;
+
+		m_slot_dirty[slot] = 1;
+		m_dirty_slots.push_back(slot);
+	}
+
+	void IndirectRenderSystem::upload_objects()
+	{
+		JvscUploader& uploader = m_renderer.uploader();
+		m_uploaded_count = 0;
+
+		// changed slots are gathered into ranges, one upload per range
+		std::sort(m_dirty_slots.begin(), m_dirty_slots.end());
+		size_t range_begin = 0;
+		size_t range_end = 0;
+		for (uint32_t slot : m_dirty_slots)
+		{
+			m_slot_dirty[slot] = 0;
+			// marked before a removal shrank the slots past it
+			if (slot >= m_object_shadow.size())
+				continue;
+
+			m_uploaded_count++;
+			if (range_end == range_begin)
+			{
+				range_begin = slot;
+			}
+			else if (slot - range_end > MAX_UPLOAD_GAP)
+			{
+				uploader.upload_buffer(m_object_buffer, range_begin * sizeof(GpuObjectData), &m_object_shadow[range_begin], (range_end - range_begin) * sizeof(GpuObjectData));
+				range_begin = slot;
+			}
+			range_end = static_cast<size_t>(slot) + 1;
+		}
+		m_dirty_slots.clear();
+
+		if (range_end > range_begin)
+			uploader.upload_buffer(m_object_buffer, range_begin * sizeof(GpuObjectData), &m_object_shadow[range_begin], (range_end - range_begin) * sizeof(GpuObjectData));
+	}
+
+	void IndirectRenderSystem::sync_mesh(const JvscMesh* mesh)
+	{
+		uint32_t id = mesh->id();
+		if (id >= m_mesh_capacity)
+			reserve_meshes(id + 1);
+		if (m_mesh_uploaded[id])
+			return;
+
+		const MeshBounds& bounds = mesh->bounds();
+		GpuMeshInfo& info = m_mesh_shadow[id];
+		info.bounds = glm::vec4(bounds.min, bounds.max);
+		info.index_count = mesh->index_count();
+		info.first_index = mesh->allocation().first_index;
+		info.vertex_offset = static_cast<int32_t>(mesh->allocation().first_vertex);
+		info.block = mesh->pool_block();
+
+		m_mesh_uploaded[id] = 1;
+		m_renderer.uploader().upload_buffer(m_mesh_buffer, id * sizeof(GpuMeshInfo), &info, sizeof(GpuMeshInfo));
+	}
+
+	void IndirectRenderSystem::reserve_objects(size_t object_count, uint32_t block_count)
+	{
+		if (object_count <= m_object_capacity && block_count <= m_block_capacity)
+			return;
+
+		wait_until_unused();
+
+		if (object_count > m_object_capacity)
+		{
+			m_object_capacity = std::max({ object_count, m_object_capacity * 2, MIN_OBJECT_CAPACITY });
+
+			destroy_buffer(m_object_buffer, m_object_allocation);
+			create_buffer(m_object_capacity * sizeof(GpuObjectData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_object_buffer, m_object_allocation);
+
+			if (!m_object_shadow.empty())
+				m_renderer.uploader().upload_buffer(m_object_buffer, 0, m_object_shadow.data(), m_object_shadow.size() * sizeof(GpuObjectData));
+		}
+		m_block_capacity = std::max(block_count, m_block_capacity);
+
+		// rewritten by cull.comp every frame, nothing to carry over
+		VkBufferUsageFlags draw_usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		destroy_buffer(m_draw_buffer, m_draw_allocation);
+		create_buffer(static_cast<VkDeviceSize>(m_block_capacity) * m_object_capacity * DRAW_COMMAND_STRIDE, draw_usage, m_draw_buffer, m_draw_allocation);
+		destroy_buffer(m_count_buffer, m_count_allocation);
+		create_buffer(m_block_capacity * sizeof(uint32_t), draw_usage, m_count_buffer, m_count_allocation);
+
+		m_descriptors_dirty = true;
+	}
+
+	void IndirectRenderSystem::reserve_meshes(uint32_t mesh_count)
+	{
+		if (mesh_count <= m_mesh_capacity)
+			return;
+
+		wait_until_unused();
+
+		uint32_t old_capacity = m_mesh_capacity;
+		m_mesh_capacity = std::max({ mesh_count, m_mesh_capacity * 2, MIN_MESH_CAPACITY });
+		m_mesh_shadow.resize(m_mesh_capacity);
+		m_mesh_uploaded.resize(m_mesh_capacity, 0);
+
+		destroy_buffer(m_mesh_buffer, m_mesh_allocation);
+		create_buffer(m_mesh_capacity * sizeof(GpuMeshInfo), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_mesh_buffer, m_mesh_allocation);
+
+		if (old_capacity > 0)
+			m_renderer.uploader().upload_buffer(m_mesh_buffer, 0, m_mesh_shadow.data(), old_capacity * sizeof(GpuMeshInfo));
+
+		m_descriptors_dirty = true;
+	}
+
+	void IndirectRenderSystem::wait_until_unused()
+	{
+		if (m_object_buffer == VK_NULL_HANDLE)
+			return;
+
+		// copies already queued for the old buffers have to land before they go away
+		m_renderer.uploader().wait_idle();
+		m_renderer.wait_for_gpu_value(m_renderer.submitted_gpu_value());
+	}
+
+	void IndirectRenderSystem::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation)
+	{
+		VkBufferCreateInfo buffer_info{};
+		buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		buffer_info.size = size;
+		buffer_info.usage = usage;
+		buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VmaAllocationCreateInfo alloc_info{};
+		alloc_info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+		if (vmaCreateBuffer(m_renderer.allocator(), &buffer_info, &alloc_info, &buffer, &allocation, nullptr) != VK_SUCCESS)
+			throw std::runtime_error("failed to create indirect render buffer");
+	}
+
+	void IndirectRenderSystem::destroy_buffer(VkBuffer& buffer, VmaAllocation& allocation)
+	{
+		if (buffer != VK_NULL_HANDLE)
+			vmaDestroyBuffer(m_renderer.allocator(), buffer, allocation);
+		buffer = VK_NULL_HANDLE;
+		allocation = VK_NULL_HANDLE;
+	}
+
+	void IndirectRenderSystem::create_descriptors()
+	{
+		// objects, meshes, draw commands, draw counts, the vertex shader only reads the objects
+		VkDescriptorSetLayoutBinding bindings[4]{};
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			bindings[i].binding = i;
+			bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[i].descriptorCount = 1;
+			bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+		bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layout_info{};
+		layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layout_info.bindingCount = 4;
+		layout_info.pBindings = bindings;
+
+		if (vkCreateDescriptorSetLayout(m_renderer.device(), &layout_info, nullptr, &m_set_layout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create indirect render descriptor set layout");
+
+		VkDescriptorPoolSize pool_size{};
+		pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		pool_size.descriptorCount = 4;
+
+		VkDescriptorPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		pool_info.maxSets = 1;
+		pool_info.poolSizeCount = 1;
+		pool_info.pPoolSizes = &pool_size;
+
+		if (vkCreateDescriptorPool(m_renderer.device(), &pool_info, nullptr, &m_descriptor_pool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create indirect render descriptor pool");
+
+		VkDescriptorSetAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		alloc_info.descriptorPool = m_descriptor_pool;
+		alloc_info.descriptorSetCount = 1;
+		alloc_info.pSetLayouts = &m_set_layout;
+
+		if (vkAllocateDescriptorSets(m_renderer.device(), &alloc_info, &m_descriptor_set) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate indirect render descriptor set");
+	}
+
+	void IndirectRenderSystem::write_descriptors()
+	{
+		VkDescriptorBufferInfo buffer_infos[4]{};
+		buffer_infos[0] = { m_object_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[1] = { m_mesh_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[2] = { m_draw_buffer, 0, VK_WHOLE_SIZE };
+		buffer_infos[3] = { m_count_buffer, 0, VK_WHOLE_SIZE };
+
+		VkWriteDescriptorSet writes[4]{};
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = m_descriptor_set;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &buffer_infos[i];
+		}
+
+		vkUpdateDescriptorSets(m_renderer.device(), 4, writes, 0, nullptr);
+	}
+
+	void IndirectRenderSystem::create_pipeline_layout()
+	{
+		VkPushConstantRange push_constant_range{};
+		push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		push_constant_range.offset = 0;
+		push_constant_range.size = sizeof(CullPushConstants);
+
+		// shared by the cull and draw pipelines so the set stays bound between them
+		VkPipelineLayoutCreateInfo layout_info{};
+		layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		layout_info.setLayoutCount = 1;
+		layout_info.pSetLayouts = &m_set_layout;
+		layout_info.pushConstantRangeCount = 1;
+		layout_info.pPushConstantRanges = &push_constant_range;
+
+		if (vkCreatePipelineLayout(m_renderer.device(), &layout_info, nullptr, &m_pipeline_layout) != VK_SUCCESS)
+			throw std::runtime_error("failed to create pipeline layout");
+	}
+
+	void IndirectRenderSystem::create_pipelines(VkRenderPass render_pass)
+	{
+		m_cull_pipeline = new JvscComputePipeline(m_renderer, "cull.comp.spv", m_pipeline_layout);
+
+		PipelineBuilder pipeline_builder{};
+		JvscPipeline::default_pipeline_builder(pipeline_builder);
+
+		pipeline_builder.renderPass = render_pass;
+		JvscPipeline::swapchain_attachments(m_renderer, pipeline_builder);
+		pipeline_builder.pipelineLayout = m_pipeline_layout;
+
+		m_pipeline = &m_renderer.pipeline_registry().request("indirect_shader.vert.spv", "simple_shader_instanced.frag.spv", pipeline_builder);
+
+		// COLOR_BY_MESH, the same shaders specialized
+		pipeline_builder.vertexConstants = SpecializationConstants::from<VkBool32>(VK_TRUE);
+		m_mesh_color_pipeline = &m_renderer.pipeline_registry().request("indirect_shader.vert.spv", "simple_shader_instanced.frag.spv", pipeline_builder);
+	}
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+// lib
+#include "jvsc_renderer.hpp"
+#include "jvsc_pipeline.hpp"
+#include "jvsc_pipeline_registry.hpp"
+#include "jvsc_mesh.hpp"
+#include "jvsc_components.hpp"
+#include "jvsc_registry.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace jvsc {
+
+	// one object as cull.comp and indirect_shader.vert read it (std430, 48 bytes)
+	struct GpuObjectData
+	{
+		glm::vec4 transform{ 1.f, 0.f, 0.f, 1.f };	// mat2 columns
+		glm::vec4 color{ 0.f };
+		glm::vec2 offset{ 0.f };
+		uint32_t mesh = UINT32_MAX;	// JvscMesh::id(), index into the mesh table
+		uint32_t padding = 0;
+	};
+
+	// a mesh's bounds and where it lives in the mesh pool, indexed by JvscMesh::id() (std430, 32 bytes)
+	struct GpuMeshInfo
+	{
+		glm::vec4 bounds{ 0.f };	// min xy, max zw
+		uint32_t index_count = 0;
+		uint32_t first_index = 0;
+		int32_t vertex_offset = 0;
+		uint32_t block = 0;
+	};
+
+	// GPU-driven alternative to CullingSystem + SimpleRenderSystem. Objects live in a device-local
+	// storage buffer that only receives the entries that changed since the last frame, found through
+	// the change lists of the RenderComponent and WorldTransform2D pools, so static objects cost
+	// nothing on the CPU; change a RenderComponent through JvscRegistry::patch(). cull.comp tests
+	// every object against the view and appends a VkDrawIndexedIndirectCommand per visible object to
+	// its mesh pool block's region, so recording costs one dispatch and one indirect draw per block
+	// whatever the object count. Needs JvscRenderer::supports_indirect_draws(); uses
+	// VK_KHR_draw_indirect_count when present, otherwise every slot of a region is drawn and the ones
+	// cull.comp did not write are zeroed no-ops. Meshes without indices are not drawn.
+	class IndirectRenderSystem
+	{
+	public:
+
+		IndirectRenderSystem(JvscRenderer& renderer, VkRenderPass render_pass);
+		~IndirectRenderSystem() = default;
+		void terminate();
+
+		// same meaning as CullingSystem::set_view
+		void set_view(glm::vec2 min, glm::vec2 max) { m_view_min = min; m_view_max = max; }
+
+		// debug view coloring every object by its mesh, drawn normally until its pipeline variant is compiled
+		void set_color_by_mesh(bool enabled) { m_color_by_mesh = enabled; }
+		bool color_by_mesh() const { return m_color_by_mesh; }
+
+		// uploads changed objects and records the culling dispatch, outside the render pass, run after TransformSystem.
+		// Consumes the change lists of the RenderComponent and WorldTransform2D pools.
+		void prepare(VkCommandBuffer cmd, JvscRegistry& registry);
+
+		// draws what the last prepare() found visible, inside the render pass
+		void render(VkCommandBuffer cmd);
+
+		size_t object_count() const { return m_object_count; }
+		// objects whose GPU copy changed in the last prepare()
+		size_t uploaded_count() const { return m_uploaded_count; }
+		// indirect draw calls recorded by the last render()
+		uint32_t indirect_draw_count() const { return m_indirect_draw_count; }
+		bool uses_draw_count() const { return m_draw_indexed_indirect_count != nullptr; }
+
+	private:
+
+		// scattered changes closer than this are uploaded as one range
+		static constexpr size_t MAX_UPLOAD_GAP = 16;
+		static constexpr uint32_t CULL_GROUP_SIZE = 64;
+		static constexpr uint32_t NO_SLOT = ~0u;
+
+		struct CullPushConstants
+		{
+			glm::vec2 view_min;
+			glm::vec2 view_max;
+			uint32_t object_count;
+			uint32_t draw_capacity;
+		};
+
+		void create_descriptors();
+		void create_pipeline_layout();
+		void create_pipelines(VkRenderPass render_pass);
+		void create_buffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VmaAllocation& allocation);
+		void destroy_buffer(VkBuffer& buffer, VmaAllocation& allocation);
+		void write_descriptors();
+
+		// grow the buffers, waiting for the GPU first, and refill them from the shadow copies
+		void reserve_objects(size_t object_count, uint32_t block_count);
+		void reserve_meshes(uint32_t mesh_count);
+		void wait_until_unused();
+
+		void sync_objects(JvscRegistry& registry);
+		void sync_object(ComponentPool<RenderComponent>& renderables, ComponentPool<WorldTransform2D>& transforms, Entity entity);
+		void remove_slot(uint32_t slot);
+		void mark_slot(uint32_t slot);
+		void upload_objects();
+		void sync_mesh(const JvscMesh* mesh);
+
+		JvscRenderer& m_renderer;
+
+		VkDescriptorSetLayout m_set_layout;
+		VkDescriptorPool m_descriptor_pool;
+		VkDescriptorSet m_descriptor_set;
+		VkPipelineLayout m_pipeline_layout;
+		JvscComputePipeline* m_cull_pipeline;
+		// owned by the renderer's pipeline registry
+		SharedPipeline* m_pipeline;
+		SharedPipeline* m_mesh_color_pipeline;
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_draw_indexed_indirect_count;
+
+		glm::vec2 m_view_min{ -1.f };
+		glm::vec2 m_view_max{ 1.f };
+		bool m_color_by_mesh = false;
+
+		// capacities in elements, the draw buffer holds m_object_capacity commands per block
+		size_t m_object_capacity = 0;
+		uint32_t m_mesh_capacity = 0;
+		uint32_t m_block_capacity = 0;
+		// mesh pool blocks as of the last prepare()
+		uint32_t m_block_count = 0;
+
+		VkBuffer m_object_buffer = VK_NULL_HANDLE;
+		VmaAllocation m_object_allocation = VK_NULL_HANDLE;
+		VkBuffer m_mesh_buffer = VK_NULL_HANDLE;
+		VmaAllocation m_mesh_allocation = VK_NULL_HANDLE;
+		VkBuffer m_draw_buffer = VK_NULL_HANDLE;
+		VmaAllocation m_draw_allocation = VK_NULL_HANDLE;
+		VkBuffer m_count_buffer = VK_NULL_HANDLE;
+		VmaAllocation m_count_allocation = VK_NULL_HANDLE;
+
+		// an entity's slot in the object buffer by entity index, the last slot fills the hole a removed one leaves
+		std::vector<uint32_t> m_slot_of;
+		std::vector<Entity> m_slot_entities;
+		// slots written since the last upload, each listed once
+		std::vector<uint32_t> m_dirty_slots;
+		std::vector<uint8_t> m_slot_dirty;
+
+		// what the GPU buffers hold, one object per slot
+		std::vector<GpuObjectData> m_object_shadow;
+		std::vector<GpuMeshInfo> m_mesh_shadow;
+		std::vector<uint8_t> m_mesh_uploaded;
+		bool m_descriptors_dirty = false;
+
+		size_t m_object_count = 0;
+		size_t m_uploaded_count = 0;
+		uint32_t m_indirect_draw_count = 0;
+	};
+
+}
@@ -6,6 +6,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+// std
+#include <algorithm>
+#include <exception>
+
 
 struct SimplePushConstantData {
 	glm::mat2 transform{ 1.f };
@@ -15,35 +19,379 @@ struct SimplePushConstantData {
 
 jvsc::SimpleRenderSystem::SimpleRenderSystem(JvscRenderer& renderer, VkRenderPass render_pass)
 	: m_renderer{renderer}
+	, m_render_pass{render_pass}
 {
 	create_pipeline_layout();
 	create_pipeline(render_pass);
+	create_instanced_pipeline(render_pass);
+	create_recording_pools();
+
+	m_instance_buffers.resize(m_renderer.max_frames_in_flight(), VK_NULL_HANDLE);
+	m_instance_allocations.resize(m_renderer.max_frames_in_flight(), VK_NULL_HANDLE);
+	m_instance_data.resize(m_renderer.max_frames_in_flight(), nullptr);
+	m_instance_capacities.resize(m_renderer.max_frames_in_flight(), 0);
 }
 
 void jvsc::SimpleRenderSystem::terminate()
 {
-	m_pipeline->destroy();
+	for (size_t i = 0; i < m_instance_buffers.size(); i++)
+	{
+		if (m_instance_buffers[i] != VK_NULL_HANDLE)
+			vmaDestroyBuffer(m_renderer.allocator(), m_instance_buffers[i], m_instance_allocations[i]);
+	}
+	m_instance_buffers.clear();
+	m_instance_allocations.clear();
+
+	// destroying the pools frees the secondary buffers
+	for (VkCommandPool pool : m_recording_pools)
+		vkDestroyCommandPool(m_renderer.device(), pool, nullptr);
+	m_recording_pools.clear();
+	m_secondary_buffers.clear();
+
+	m_renderer.pipeline_registry().release_layout(m_pipeline_layout);
 	vkDestroyPipelineLayout(m_renderer.device(), m_pipeline_layout, nullptr);
 }
 
-void jvsc::SimpleRenderSystem::render_game_objects(VkCommandBuffer cmd, std::vector<JvscGameObject>& game_objects)
+void jvsc::SimpleRenderSystem::render_game_objects(VkCommandBuffer cmd, JvscRegistry& registry)
+{
+	size_t count = registry.pack<RenderComponent, WorldTransform2D>();
+	if (m_all_objects.size() != count)
+	{
+		m_all_objects.resize(count);
+		for (uint32_t i = 0; i < count; i++)
+			m_all_objects[i] = i;
+	}
+
+	render_game_objects(cmd, registry, m_all_objects);
+}
+
+void jvsc::SimpleRenderSystem::render_game_objects(VkCommandBuffer cmd, JvscRegistry& registry, const std::vector<uint32_t>& objects_to_draw)
+{
+	JVSC_PROFILE_SCOPE("SimpleRenderSystem::render_game_objects");
+
+	// pipelines compile in the background: instanced drawing falls back to per-object drawing until
+	// its pipeline is ready, nothing is drawn before the simple pipeline is
+	RenderMode mode = m_render_mode;
+	if (mode == RenderMode::Instanced && !m_instanced_pipeline->ready())
+		mode = RenderMode::PerObject;
+	if (mode != RenderMode::Instanced && !m_pipeline->ready())
+	{
+		m_draw_stats = DrawStats{};
+		m_draw_stats.skipped_draws = static_cast<uint32_t>(objects_to_draw.size());
+		return;
+	}
+
+	// renderables with a transform are packed to the front of both pools, so index i of one matches index i of the other
+	RenderList objects{};
+	registry.pack<RenderComponent, WorldTransform2D>();
+	objects.renderables = registry.pool<RenderComponent>().data();
+	objects.transforms = registry.pool<WorldTransform2D>().data();
+	objects.indices = objects_to_draw.data();
+	objects.count = objects_to_draw.size();
+
+	build_draw_list(objects, mode == RenderMode::Instanced ? INSTANCED_PIPELINE : SIMPLE_PIPELINE);
+
+	// the primary buffer only executes the secondary ones in parallel mode, record_chunk() sets them there
+	if (mode != RenderMode::Parallel)
+		m_renderer.set_swapchain_viewport(cmd);
+
+	if (mode == RenderMode::Instanced)
+		render_instanced(cmd, objects);
+	else if (mode == RenderMode::Parallel)
+		render_parallel(cmd, objects);
+	else
+		render_per_object(cmd, objects);
+}
+
+void jvsc::SimpleRenderSystem::build_draw_list(const RenderList& objects, uint32_t pipeline)
+{
+	m_draw_stats = DrawStats{};
+	m_draw_list.clear();
+	m_draw_list.reserve(objects.count);
+
+	// binds the objects would need recorded as they come, to report what sorting saves
+	uint32_t previous_block = UINT32_MAX;
+	if (objects.count > 0)
+		m_draw_stats.unsorted_binds++;
+
+	for (size_t i = 0; i < objects.count; i++)
+	{
+		uint32_t object = objects.indices[i];
+		const JvscMesh* mesh = objects.renderables[object].mesh;
+
+		if (mesh->pool_block() != previous_block)
+		{
+			m_draw_stats.unsorted_binds++;
+			previous_block = mesh->pool_block();
+		}
+
+		m_draw_list.add(JvscDrawList::make_key(pipeline, mesh->pool_block(), mesh->id(), 0, 0.f), object);
+	}
+
+	m_draw_list.sort();
+}
+
+jvsc::JvscPipeline* jvsc::SimpleRenderSystem::pipeline_for(uint32_t pipeline)
+{
+	return pipeline == INSTANCED_PIPELINE ? m_instanced_pipeline->get() : m_pipeline->get();
+}
+
+void jvsc::SimpleRenderSystem::render_per_object(VkCommandBuffer cmd, const RenderList& objects)
 {
-	m_pipeline->bind(cmd);
+	record_objects(cmd, objects, 0, m_draw_list.size(), m_draw_stats);
+}
 
-	for (auto& obj : game_objects)
+void jvsc::SimpleRenderSystem::record_objects(VkCommandBuffer cmd, const RenderList& objects, size_t begin, size_t end, DrawStats& stats)
+{
+	// the draw list is sorted by pipeline, then pool block, so each only changes a handful of times
+	uint32_t bound_pipeline = UINT32_MAX;
+	uint32_t bound_block = UINT32_MAX;
+	for (size_t i = begin; i < end; i++)
 	{
+		const DrawItem& item = m_draw_list[i];
+
+		uint32_t pipeline = JvscDrawList::key_pipeline(item.key);
+		if (pipeline != bound_pipeline)
+		{
+			pipeline_for(pipeline)->bind(cmd);
+			bound_pipeline = pipeline;
+			stats.pipeline_binds++;
+		}
+
+		const RenderComponent& renderable = objects.renderables[item.object];
+		const WorldTransform2D& transform = objects.transforms[item.object];
+
 		SimplePushConstantData push;
-		push.offset = obj.transform.translation;
-		push.color = obj.color;
-		push.transform = obj.transform.mat2();
+		push.offset = transform.offset;
+		push.color = renderable.color;
+		push.transform = transform.matrix;
 
 		vkCmdPushConstants(cmd, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
 		
-		obj.mesh->bind(cmd);
-		obj.mesh->draw(cmd);
+		if (renderable.mesh->pool_block() != bound_block)
+		{
+			renderable.mesh->bind(cmd);
+			bound_block = renderable.mesh->pool_block();
+			stats.buffer_binds++;
+		}
+		renderable.mesh->draw(cmd);
+		stats.draws++;
+	}
+}
+
+void jvsc::SimpleRenderSystem::render_parallel(VkCommandBuffer cmd, const RenderList& objects)
+{
+	size_t draw_count = m_draw_list.size();
+	if (draw_count == 0)
+		return;
+
+	uint32_t frame = m_renderer.frame_index();
+
+	size_t chunk_count = (draw_count + MIN_OBJECTS_PER_CHUNK - 1) / MIN_OBJECTS_PER_CHUNK;
+	chunk_count = std::clamp<size_t>(chunk_count, 1, m_recording_threads);
+	size_t chunk_size = (draw_count + chunk_count - 1) / chunk_count;
+
+	// each chunk records into its own pool slot, whichever thread ends up running it
+	JvscJobSystem& jobs = JvscJobSystem::get();
+	JobCounter recorded;
+	std::vector<std::exception_ptr> errors(chunk_count);
+	std::vector<DrawStats> chunk_stats(chunk_count);
+
+	for (size_t chunk = 0; chunk < chunk_count; chunk++)
+	{
+		size_t begin = chunk * chunk_size;
+		size_t end = std::min(begin + chunk_size, draw_count);
+		jobs.run([this, frame, chunk, begin, end, &objects, &errors, &chunk_stats]() {
+			try
+			{
+				record_chunk(frame, static_cast<uint32_t>(chunk), objects, begin, end, chunk_stats[chunk]);
+			}
+			catch (...)
+			{
+				errors[chunk] = std::current_exception();
+			}
+		}, &recorded);
+	}
+
+	// the render thread records chunks too while it waits
+	jobs.wait(recorded);
+
+	for (auto& error : errors)
+	{
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	// secondaries start without state, each chunk binds its own pipeline and buffers
+	for (const DrawStats& stats : chunk_stats)
+	{
+		m_draw_stats.draws += stats.draws;
+		m_draw_stats.pipeline_binds += stats.pipeline_binds;
+		m_draw_stats.buffer_binds += stats.buffer_binds;
+	}
+
+	vkCmdExecuteCommands(cmd, static_cast<uint32_t>(chunk_count), &m_secondary_buffers[frame * m_max_recording_threads]);
+}
+
+void jvsc::SimpleRenderSystem::record_chunk(uint32_t frame, uint32_t chunk, const RenderList& objects, size_t begin, size_t end, DrawStats& stats)
+{
+	JVSC_PROFILE_SCOPE("SimpleRenderSystem::record_chunk");
+
+	uint32_t slot = frame * m_max_recording_threads + chunk;
+
+	// the frame's fence has signaled, so this chunk's pool for the frame is idle
+	vkResetCommandPool(m_renderer.device(), m_recording_pools[slot], 0);
+
+	VkCommandBufferInheritanceInfo inheritance_info{};
+	inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance_info.renderPass = m_render_pass;
+	inheritance_info.subpass = 0;
+	inheritance_info.framebuffer = m_renderer.current_framebuffer();
+
+	// without a render pass the attachments are described by their formats instead
+	VkFormat color_format = m_renderer.image_format();
+	VkCommandBufferInheritanceRenderingInfoKHR rendering_info{};
+	if (m_render_pass == VK_NULL_HANDLE)
+	{
+		rendering_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+		rendering_info.colorAttachmentCount = 1;
+		rendering_info.pColorAttachmentFormats = &color_format;
+		rendering_info.depthAttachmentFormat = m_renderer.depth_format();
+		rendering_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		inheritance_info.pNext = &rendering_info;
+	}
+
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	begin_info.pInheritanceInfo = &inheritance_info;
+
+	VkCommandBuffer secondary = m_secondary_buffers[slot];
+	if (vkBeginCommandBuffer(secondary, &begin_info) != VK_SUCCESS)
+		throw std::runtime_error("failed to begin secondary command buffer");
+
+	// dynamic state is not inherited from the primary buffer
+	m_renderer.set_swapchain_viewport(secondary);
+	record_objects(secondary, objects, begin, end, stats);
+
+	if (vkEndCommandBuffer(secondary) != VK_SUCCESS)
+		throw std::runtime_error("failed to record secondary command buffer");
+}
+
+void jvsc::SimpleRenderSystem::create_recording_pools()
+{
+	m_max_recording_threads = JvscJobSystem::get().thread_count();
+	m_recording_threads = m_max_recording_threads;
+
+	size_t slot_count = static_cast<size_t>(m_renderer.max_frames_in_flight()) * m_max_recording_threads;
+	m_recording_pools.resize(slot_count);
+	m_secondary_buffers.resize(slot_count);
+
+	for (size_t i = 0; i < slot_count; i++)
+	{
+		VkCommandPoolCreateInfo pool_info{};
+		pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		pool_info.queueFamilyIndex = m_renderer.graphics_family_index();
+		pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		if (vkCreateCommandPool(m_renderer.device(), &pool_info, nullptr, &m_recording_pools[i]) != VK_SUCCESS)
+			throw std::runtime_error("failed to create recording command pool");
+
+		VkCommandBufferAllocateInfo alloc_info{};
+		alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		alloc_info.commandPool = m_recording_pools[i];
+		alloc_info.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_renderer.device(), &alloc_info, &m_secondary_buffers[i]) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate secondary command buffer");
+	}
+}
+
+void jvsc::SimpleRenderSystem::render_instanced(VkCommandBuffer cmd, const RenderList& objects)
+{
+	size_t draw_count = m_draw_list.size();
+	if (draw_count == 0)
+		return;
+
+	uint32_t frame = m_renderer.frame_index();
+	reserve_instance_buffer(frame, draw_count);
+
+	// the sorted draw list already has objects sharing a mesh next to each other,
+	// so each run of one mesh becomes a contiguous instance range
+	const RenderComponent* renderables = objects.renderables;
+	SimpleInstanceData* instances = m_instance_data[frame];
+	for (size_t i = 0; i < draw_count; i++)
+	{
+		uint32_t object = m_draw_list[i].object;
+		instances[i].transform = objects.transforms[object].matrix;
+		instances[i].offset = objects.transforms[object].offset;
+		instances[i].color = renderables[object].color;
+	}
+	vmaFlushAllocation(m_renderer.allocator(), m_instance_allocations[frame], 0, sizeof(SimpleInstanceData) * draw_count);
+
+	m_instanced_pipeline->get()->bind(cmd);
+	m_draw_stats.pipeline_binds++;
+
+	VkBuffer instance_buffers[] = { m_instance_buffers[frame] };
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(cmd, 1, 1, instance_buffers, offsets);
+
+	uint32_t bound_block = UINT32_MAX;
+	uint32_t first = 0;
+	while (first < draw_count)
+	{
+		JvscMesh* mesh = renderables[m_draw_list[first].object].mesh;
+
+		// mesh ids in the key can wrap, the pointer decides what is really the same mesh
+		uint32_t last = first + 1;
+		while (last < draw_count && renderables[m_draw_list[last].object].mesh == mesh)
+			last++;
+
+		if (mesh->pool_block() != bound_block)
+		{
+			mesh->bind(cmd);
+			bound_block = mesh->pool_block();
+			m_draw_stats.buffer_binds++;
+		}
+		mesh->draw(cmd, last - first, first);
+		m_draw_stats.draws++;
+
+		first = last;
 	}
 }
 
+void jvsc::SimpleRenderSystem::reserve_instance_buffer(uint32_t frame, size_t instance_count)
+{
+	if (instance_count <= m_instance_capacities[frame])
+		return;
+
+	// the frame's fence was waited on in begin_frame, so its old buffer is no longer in use
+	if (m_instance_buffers[frame] != VK_NULL_HANDLE)
+		vmaDestroyBuffer(m_renderer.allocator(), m_instance_buffers[frame], m_instance_allocations[frame]);
+
+	size_t capacity = std::max<size_t>(m_instance_capacities[frame], 1024);
+	while (capacity < instance_count)
+		capacity *= 2;
+
+	VkBufferCreateInfo buffer_info{};
+	buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	buffer_info.size = sizeof(SimpleInstanceData) * capacity;
+	buffer_info.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+	buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo alloc_info{};
+	alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+	alloc_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo allocation_info;
+	if (vmaCreateBuffer(m_renderer.allocator(), &buffer_info, &alloc_info, &m_instance_buffers[frame], &m_instance_allocations[frame], &allocation_info) != VK_SUCCESS)
+		throw std::runtime_error("failed to create instance buffer");
+
+	m_instance_data[frame] = static_cast<SimpleInstanceData*>(allocation_info.pMappedData);
+	m_instance_capacities[frame] = capacity;
+}
+
 void jvsc::SimpleRenderSystem::create_pipeline_layout()
 {
 	VkPushConstantRange push_constant_range{};
@@ -65,20 +413,64 @@ void jvsc::SimpleRenderSystem::create_pipeline(VkRenderPass render_pass)
 	jvsc::PipelineBuilder pipeline_builder{};
 	jvsc::JvscPipeline::default_pipeline_builder(pipeline_builder);
 
-	VkViewport viewport;
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(m_renderer.extent().width);
-	viewport.height = static_cast<float>(m_renderer.extent().height);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
+	pipeline_builder.renderPass = render_pass;
+	jvsc::JvscPipeline::swapchain_attachments(m_renderer, pipeline_builder);
+	pipeline_builder.pipelineLayout = m_pipeline_layout;
 
-	VkRect2D scissor{ {0, 0}, m_renderer.extent() };
+	m_pipeline = &m_renderer.pipeline_registry().request("simple_shader.vert.spv", "simple_shader.frag.spv", pipeline_builder);
+}
+
+void jvsc::SimpleRenderSystem::create_instanced_pipeline(VkRenderPass render_pass)
+{
+	jvsc::PipelineBuilder pipeline_builder{};
+	jvsc::JvscPipeline::default_pipeline_builder(pipeline_builder);
 
-	pipeline_builder.viewportInfo.pViewports = &viewport;
-	pipeline_builder.viewportInfo.pScissors = &scissor;
 	pipeline_builder.renderPass = render_pass;
+	jvsc::JvscPipeline::swapchain_attachments(m_renderer, pipeline_builder);
 	pipeline_builder.pipelineLayout = m_pipeline_layout;
 
-	m_pipeline = new jvsc::JvscPipeline(m_renderer, "simple_shader.vert.spv", "simple_shader.frag.spv", pipeline_builder);
+	auto instance_bindings = SimpleInstanceData::get_binding_descriptions();
+	auto instance_attributes = SimpleInstanceData::get_attribute_descriptions();
+	pipeline_builder.bindingDescriptions.insert(pipeline_builder.bindingDescriptions.end(), instance_bindings.begin(), instance_bindings.end());
+	pipeline_builder.attributeDescriptions.insert(pipeline_builder.attributeDescriptions.end(), instance_attributes.begin(), instance_attributes.end());
+
+	m_instanced_pipeline = &m_renderer.pipeline_registry().request("simple_shader_instanced.vert.spv", "simple_shader_instanced.frag.spv", pipeline_builder);
+}
+
+std::vector<VkVertexInputBindingDescription> jvsc::SimpleInstanceData::get_binding_descriptions()
+{
+	std::vector<VkVertexInputBindingDescription> bindings(1);
+
+	bindings[0].binding = 1;
+	bindings[0].stride = sizeof(SimpleInstanceData);
+	bindings[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	return bindings;
+}
+
+std::vector<VkVertexInputAttributeDescription> jvsc::SimpleInstanceData::get_attribute_descriptions()
+{
+	std::vector<VkVertexInputAttributeDescription> attributes(4);
+
+	// mat2 takes one location per column
+	attributes[0].binding = 1;
+	attributes[0].location = 2;
+	attributes[0].format = VK_FORMAT_R32G32_SFLOAT;
+	attributes[0].offset = offsetof(SimpleInstanceData, transform);
+
+	attributes[1].binding = 1;
+	attributes[1].location = 3;
+	attributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+	attributes[1].offset = offsetof(SimpleInstanceData, transform) + sizeof(glm::vec2);
+
+	attributes[2].binding = 1;
+	attributes[2].location = 4;
+	attributes[2].format = VK_FORMAT_R32G32_SFLOAT;
+	attributes[2].offset = offsetof(SimpleInstanceData, offset);
+
+	attributes[3].binding = 1;
+	attributes[3].location = 5;
+	attributes[3].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributes[3].offset = offsetof(SimpleInstanceData, color);
+
+	return attributes;
 }
@@ -3,31 +3,139 @@
 // lib
 #include "jvsc_renderer.hpp"
 #include "jvsc_pipeline.hpp"
-#include "jvsc_game_object.hpp"
+#include "jvsc_pipeline_registry.hpp"
+#include "jvsc_mesh.hpp"
+#include "jvsc_components.hpp"
+#include "jvsc_registry.hpp"
+#include "jvsc_draw_list.hpp"
+#include "jvsc_job_system.hpp"
+
+// std
+#include <algorithm>
 
 namespace jvsc {
 
+	// per-instance vertex data read by simple_shader_instanced.vert (binding 1)
+	struct SimpleInstanceData
+	{
+		glm::mat2 transform{ 1.f };
+		glm::vec2 offset;
+		glm::vec3 color;
+
+		static std::vector<VkVertexInputBindingDescription> get_binding_descriptions();
+		static std::vector<VkVertexInputAttributeDescription> get_attribute_descriptions();
+	};
+
 	class SimpleRenderSystem
 	{
 	public:
 
+		enum class RenderMode
+		{
+			PerObject,	// one push constant + draw per object
+			Instanced,	// objects grouped by mesh, one instanced draw per mesh
+			Parallel	// per object, recorded into secondary command buffers on the job system
+		};
+
+		// chunks smaller than this are not worth a job
+		static constexpr size_t MIN_OBJECTS_PER_CHUNK = 256;
+
+		// what the last render_game_objects recorded
+		struct DrawStats
+		{
+			uint32_t draws = 0;
+			uint32_t pipeline_binds = 0;
+			uint32_t buffer_binds = 0;
+			// pipeline and buffer binds the same objects would have taken recorded in the order they came in
+			uint32_t unsorted_binds = 0;
+			// objects not drawn because their pipeline was still compiling
+			uint32_t skipped_draws = 0;
+
+			uint32_t binds() const { return pipeline_binds + buffer_binds; }
+			int32_t saved_binds() const { return static_cast<int32_t>(unsorted_binds) - static_cast<int32_t>(binds()); }
+		};
+
 		SimpleRenderSystem(JvscRenderer& renderer, VkRenderPass render_pass);
 		~SimpleRenderSystem() = default;
 		void terminate();
 
-		void render_game_objects(VkCommandBuffer cmd, std::vector<JvscGameObject>& game_objects);
+		// draws every entity with both a RenderComponent and a WorldTransform2D, run TransformSystem first
+		void render_game_objects(VkCommandBuffer cmd, JvscRegistry& registry);
+
+		// only the listed indices into the packed pools, e.g. CullingSystem::visible()
+		void render_game_objects(VkCommandBuffer cmd, JvscRegistry& registry, const std::vector<uint32_t>& objects_to_draw);
+
+		void set_render_mode(RenderMode mode) { m_render_mode = mode; }
+		RenderMode render_mode() const { return m_render_mode; }
+
+		// the swapchain render pass must be begun with these contents before render_game_objects
+		VkSubpassContents subpass_contents() const { return m_render_mode == RenderMode::Parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE; }
+
+		void set_recording_threads(uint32_t count) { m_recording_threads = std::clamp(count, 1u, m_max_recording_threads); }
+		uint32_t recording_threads() const { return m_recording_threads; }
+
+		const DrawStats& draw_stats() const { return m_draw_stats; }
 
 	private:
-	
+
+		// pipeline field of the draw sort keys
+		static constexpr uint32_t SIMPLE_PIPELINE = 0;
+		static constexpr uint32_t INSTANCED_PIPELINE = 1;
+
+		// parallel views into the registry's packed component arrays, and which entries to draw
+		struct RenderList
+		{
+			const RenderComponent* renderables;
+			const WorldTransform2D* transforms;
+			const uint32_t* indices;
+			size_t count;
+		};
+
 		void create_pipeline_layout();
 		void create_pipeline(VkRenderPass render_pass);
+		void create_instanced_pipeline(VkRenderPass render_pass);
+		void create_recording_pools();
+
+		void build_draw_list(const RenderList& objects, uint32_t pipeline);
+		JvscPipeline* pipeline_for(uint32_t pipeline);
+
+		void render_per_object(VkCommandBuffer cmd, const RenderList& objects);
+		void render_instanced(VkCommandBuffer cmd, const RenderList& objects);
+		void render_parallel(VkCommandBuffer cmd, const RenderList& objects);
+		void record_objects(VkCommandBuffer cmd, const RenderList& objects, size_t begin, size_t end, DrawStats& stats);
+		void record_chunk(uint32_t frame, uint32_t chunk, const RenderList& objects, size_t begin, size_t end, DrawStats& stats);
+		void reserve_instance_buffer(uint32_t frame, size_t instance_count);
 
 
 		JvscRenderer& m_renderer;
 
-		JvscPipeline* m_pipeline;
+		// owned by the renderer's pipeline registry
+		SharedPipeline* m_pipeline;
+		SharedPipeline* m_instanced_pipeline;
 		VkPipelineLayout m_pipeline_layout;
+		VkRenderPass m_render_pass;
+
+		RenderMode m_render_mode = RenderMode::PerObject;
+
+		// one instance buffer per frame in flight, persistently mapped
+		std::vector<VkBuffer> m_instance_buffers;
+		std::vector<VmaAllocation> m_instance_allocations;
+		std::vector<SimpleInstanceData*> m_instance_data;
+		std::vector<size_t> m_instance_capacities;
+
+		// the objects to draw sorted by state, reused across frames
+		JvscDrawList m_draw_list;
+		DrawStats m_draw_stats;
+
+		// 0..n-1 for drawing without a culled list
+		std::vector<uint32_t> m_all_objects;
+
+		// one pool and secondary buffer per recording chunk per frame, indexed [frame * max threads + chunk]
+		uint32_t m_max_recording_threads;
+		uint32_t m_recording_threads;
+		std::vector<VkCommandPool> m_recording_pools;
+		std::vector<VkCommandBuffer> m_secondary_buffers;
 
 	};
 
-}
\ No newline at end of file
+}
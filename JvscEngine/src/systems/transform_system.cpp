@@ -0,0 +1,306 @@
+#include "transform_system.hpp"
+
+// lib
+#include "jvsc_profiler.hpp"
+
+// std
+#include <cmath>
+
+// platform
+#if defined(_M_X64) || defined(__x86_64__)
+	#define JVSC_X64
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		#define JVSC_TARGET_AVX2
+	#else
+		#define JVSC_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+namespace jvsc {
+
+	namespace {
+
+		// matrix layout matches Transform2D::mat2(): columns (c * sx, s * sx) and (-s * sy, c * sy)
+		void build_matrix(const Transform2D& in, WorldTransform2D& out)
+		{
+			const float s = std::sin(in.rotation);
+			const float c = std::cos(in.rotation);
+			out.matrix[0] = glm::vec2{ c * in.scale.x, s * in.scale.x };
+			out.matrix[1] = glm::vec2{ -s * in.scale.y, c * in.scale.y };
+		}
+
+		void build_matrices_scalar(const Transform2D* in, WorldTransform2D* out, const uint32_t* indices, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				build_matrix(in[indices[i]], out[indices[i]]);
+		}
+
+	#ifdef JVSC_X64
+
+		// Cephes sinf/cosf: reduce to [-pi/4, pi/4] by octant, then a minimax polynomial for each.
+		// Good to a couple of ulp for |x| below a few thousand radians, plenty for rotations.
+		constexpr float FOUR_OVER_PI = 1.27323954473516f;
+		constexpr float MINUS_DP1 = -0.78515625f;
+		constexpr float MINUS_DP2 = -2.4187564849853515625e-4f;
+		constexpr float MINUS_DP3 = -3.77489497744594108e-8f;
+		constexpr float SIN_P0 = -1.9515295891e-4f;
+		constexpr float SIN_P1 = 8.3321608736e-3f;
+		constexpr float SIN_P2 = -1.6666654611e-1f;
+		constexpr float COS_P0 = 2.443315711809948e-5f;
+		constexpr float COS_P1 = -1.388731625493765e-3f;
+		constexpr float COS_P2 = 4.166664568298827e-2f;
+
+		void sincos_sse2(__m128 x, __m128& out_sin, __m128& out_cos)
+		{
+			const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)));
+
+			__m128 sign_sin = _mm_and_ps(x, sign_mask);
+			x = _mm_andnot_ps(sign_mask, x);
+
+			// octant, rounded up to even so the remainder lands in [-pi/4, pi/4]
+			__m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+			octant = _mm_and_si128(_mm_add_epi32(octant, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+			__m128 y = _mm_cvtepi32_ps(octant);
+
+			__m128 swap_sign_sin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, _mm_set1_epi32(4)), 29));
+			__m128 sign_cos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+			__m128 poly_mask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, _mm_set1_epi32(2)), _mm_setzero_si128()));
+			sign_sin = _mm_xor_ps(sign_sin, swap_sign_sin);
+
+			// x - y * pi/4 in three steps to keep the precision
+			x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP1)));
+			x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP2)));
+			x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(MINUS_DP3)));
+			__m128 z = _mm_mul_ps(x, x);
+
+			__m128 poly_cos = _mm_set1_ps(COS_P0);
+			poly_cos = _mm_add_ps(_mm_mul_ps(poly_cos, z), _mm_set1_ps(COS_P1));
+			poly_cos = _mm_add_ps(_mm_mul_ps(poly_cos, z), _mm_set1_ps(COS_P2));
+			poly_cos = _mm_mul_ps(_mm_mul_ps(poly_cos, z), z);
+			poly_cos = _mm_sub_ps(poly_cos, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+			poly_cos = _mm_add_ps(poly_cos, _mm_set1_ps(1.0f));
+
+			__m128 poly_sin = _mm_set1_ps(SIN_P0);
+			poly_sin = _mm_add_ps(_mm_mul_ps(poly_sin, z), _mm_set1_ps(SIN_P1));
+			poly_sin = _mm_add_ps(_mm_mul_ps(poly_sin, z), _mm_set1_ps(SIN_P2));
+			poly_sin = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(poly_sin, z), x), x);
+
+			// odd octants swap the two polynomials
+			__m128 sin_value = _mm_or_ps(_mm_and_ps(poly_mask, poly_sin), _mm_andnot_ps(poly_mask, poly_cos));
+			__m128 cos_value = _mm_or_ps(_mm_and_ps(poly_mask, poly_cos), _mm_andnot_ps(poly_mask, poly_sin));
+
+			out_sin = _mm_xor_ps(sin_value, sign_sin);
+			out_cos = _mm_xor_ps(cos_value, sign_cos);
+		}
+
+		// four objects' columns in SoA registers to four mat2s, written straight into the components
+		void store_matrices_sse2(__m128 m00, __m128 m01, __m128 m10, __m128 m11, WorldTransform2D* out, const uint32_t* indices)
+		{
+			_MM_TRANSPOSE4_PS(m00, m01, m10, m11);
+			_mm_storeu_ps(&out[indices[0]].matrix[0][0], m00);
+			_mm_storeu_ps(&out[indices[1]].matrix[0][0], m01);
+			_mm_storeu_ps(&out[indices[2]].matrix[0][0], m10);
+			_mm_storeu_ps(&out[indices[3]].matrix[0][0], m11);
+		}
+
+		void build_matrices_sse2(const Transform2D* in, WorldTransform2D* out, const uint32_t* indices, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				const Transform2D& t0 = in[indices[i + 0]];
+				const Transform2D& t1 = in[indices[i + 1]];
+				const Transform2D& t2 = in[indices[i + 2]];
+				const Transform2D& t3 = in[indices[i + 3]];
+
+				__m128 rotation = _mm_setr_ps(t0.rotation, t1.rotation, t2.rotation, t3.rotation);
+				__m128 scale_x = _mm_setr_ps(t0.scale.x, t1.scale.x, t2.scale.x, t3.scale.x);
+				__m128 scale_y = _mm_setr_ps(t0.scale.y, t1.scale.y, t2.scale.y, t3.scale.y);
+
+				__m128 s, c;
+				sincos_sse2(rotation, s, c);
+
+				__m128 m00 = _mm_mul_ps(c, scale_x);
+				__m128 m01 = _mm_mul_ps(s, scale_x);
+				__m128 m10 = _mm_xor_ps(_mm_mul_ps(s, scale_y), _mm_set1_ps(-0.0f));
+				__m128 m11 = _mm_mul_ps(c, scale_y);
+				store_matrices_sse2(m00, m01, m10, m11, out, indices + i);
+			}
+
+			build_matrices_scalar(in, out, indices + i, count - i);
+		}
+
+		JVSC_TARGET_AVX2 void sincos_avx2(__m256 x, __m256& out_sin, __m256& out_cos)
+		{
+			const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(static_cast<int>(0x80000000u)));
+
+			__m256 sign_sin = _mm256_and_ps(x, sign_mask);
+			x = _mm256_andnot_ps(sign_mask, x);
+
+			__m256i octant = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI)));
+			octant = _mm256_and_si256(_mm256_add_epi32(octant, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+			__m256 y = _mm256_cvtepi32_ps(octant);
+
+			__m256 swap_sign_sin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(4)), 29));
+			__m256 sign_cos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(octant, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+			__m256 poly_mask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(octant, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+			sign_sin = _mm256_xor_ps(sign_sin, swap_sign_sin);
+
+			x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP1)));
+			x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP2)));
+			x = _mm256_add_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(MINUS_DP3)));
+			__m256 z = _mm256_mul_ps(x, x);
+
+			__m256 poly_cos = _mm256_set1_ps(COS_P0);
+			poly_cos = _mm256_add_ps(_mm256_mul_ps(poly_cos, z), _mm256_set1_ps(COS_P1));
+			poly_cos = _mm256_add_ps(_mm256_mul_ps(poly_cos, z), _mm256_set1_ps(COS_P2));
+			poly_cos = _mm256_mul_ps(_mm256_mul_ps(poly_cos, z), z);
+			poly_cos = _mm256_sub_ps(poly_cos, _mm256_mul_ps(z, _mm256_set1_ps(0.5f)));
+			poly_cos = _mm256_add_ps(poly_cos, _mm256_set1_ps(1.0f));
+
+			__m256 poly_sin = _mm256_set1_ps(SIN_P0);
+			poly_sin = _mm256_add_ps(_mm256_mul_ps(poly_sin, z), _mm256_set1_ps(SIN_P1));
+			poly_sin = _mm256_add_ps(_mm256_mul_ps(poly_sin, z), _mm256_set1_ps(SIN_P2));
+			poly_sin = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(poly_sin, z), x), x);
+
+			__m256 sin_value = _mm256_blendv_ps(poly_cos, poly_sin, poly_mask);
+			__m256 cos_value = _mm256_blendv_ps(poly_sin, poly_cos, poly_mask);
+
+			out_sin = _mm256_xor_ps(sin_value, sign_sin);
+			out_cos = _mm256_xor_ps(cos_value, sign_cos);
+		}
+
+		JVSC_TARGET_AVX2 void build_matrices_avx2(const Transform2D* in, WorldTransform2D* out, const uint32_t* indices, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const uint32_t* batch = indices + i;
+
+				// lane k holds in[batch[k]], gathered by hand since Transform2D is 20 bytes wide
+				__m256 rotation = _mm256_setr_ps(
+					in[batch[0]].rotation, in[batch[1]].rotation, in[batch[2]].rotation, in[batch[3]].rotation,
+					in[batch[4]].rotation, in[batch[5]].rotation, in[batch[6]].rotation, in[batch[7]].rotation);
+				__m256 scale_x = _mm256_setr_ps(
+					in[batch[0]].scale.x, in[batch[1]].scale.x, in[batch[2]].scale.x, in[batch[3]].scale.x,
+					in[batch[4]].scale.x, in[batch[5]].scale.x, in[batch[6]].scale.x, in[batch[7]].scale.x);
+				__m256 scale_y = _mm256_setr_ps(
+					in[batch[0]].scale.y, in[batch[1]].scale.y, in[batch[2]].scale.y, in[batch[3]].scale.y,
+					in[batch[4]].scale.y, in[batch[5]].scale.y, in[batch[6]].scale.y, in[batch[7]].scale.y);
+
+				__m256 s, c;
+				sincos_avx2(rotation, s, c);
+
+				__m256 m00 = _mm256_mul_ps(c, scale_x);
+				__m256 m01 = _mm256_mul_ps(s, scale_x);
+				__m256 m10 = _mm256_xor_ps(_mm256_mul_ps(s, scale_y), _mm256_set1_ps(-0.0f));
+				__m256 m11 = _mm256_mul_ps(c, scale_y);
+
+				// transpose within each 128-bit half, objects k and k + 4 share a register
+				__m256 t0 = _mm256_unpacklo_ps(m00, m01);
+				__m256 t1 = _mm256_unpackhi_ps(m00, m01);
+				__m256 t2 = _mm256_unpacklo_ps(m10, m11);
+				__m256 t3 = _mm256_unpackhi_ps(m10, m11);
+				__m256 r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+				__m256 r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+				__m256 r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+				__m256 r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+				_mm_storeu_ps(&out[batch[0]].matrix[0][0], _mm256_castps256_ps128(r0));
+				_mm_storeu_ps(&out[batch[1]].matrix[0][0], _mm256_castps256_ps128(r1));
+				_mm_storeu_ps(&out[batch[2]].matrix[0][0], _mm256_castps256_ps128(r2));
+				_mm_storeu_ps(&out[batch[3]].matrix[0][0], _mm256_castps256_ps128(r3));
+				_mm_storeu_ps(&out[batch[4]].matrix[0][0], _mm256_extractf128_ps(r0, 1));
+				_mm_storeu_ps(&out[batch[5]].matrix[0][0], _mm256_extractf128_ps(r1, 1));
+				_mm_storeu_ps(&out[batch[6]].matrix[0][0], _mm256_extractf128_ps(r2, 1));
+				_mm_storeu_ps(&out[batch[7]].matrix[0][0], _mm256_extractf128_ps(r3, 1));
+			}
+
+			// leave the ymm registers clean before the SSE tail
+			_mm256_zeroupper();
+
+			build_matrices_sse2(in, out, indices + i, count - i);
+		}
+
+	#endif
+
+	}
+
+	const TransformSystem::SimdLevel TransformSystem::s_supported_level = TransformSystem::detect_simd_level();
+
+	TransformSystem::TransformSystem()
+		: m_simd_level{s_supported_level}
+	{
+	}
+
+	TransformSystem::SimdLevel TransformSystem::detect_simd_level()
+	{
+	#ifdef JVSC_X64
+		// SSE2 is part of x86-64, AVX2 also needs the OS to save the ymm registers
+		#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 1);
+			bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			bool avx2 = os_saves_ymm && (info[1] & (1 << 5));
+		#else
+			__builtin_cpu_init();
+			bool avx2 = __builtin_cpu_supports("avx2");
+		#endif
+		return avx2 ? SimdLevel::AVX2 : SimdLevel::SSE2;
+	#else
+		return SimdLevel::Scalar;
+	#endif
+	}
+
+	void TransformSystem::update(JvscRegistry& registry)
+	{
+		JVSC_PROFILE_SCOPE("TransformSystem::update");
+
+		// WorldTransform2D leads so the order SimpleRenderSystem packs it into is kept, Transform2D follows it
+		auto& transforms = registry.pool<Transform2D>();
+		size_t count = registry.pack<WorldTransform2D, Transform2D>();
+		if (count < transforms.size())
+		{
+			// pack leaves the Transform2Ds without a WorldTransform2D at the back
+			for (size_t i = count; i < transforms.size(); i++)
+				registry.add<WorldTransform2D>(transforms.entity_at(i));
+			count = registry.pack<WorldTransform2D, Transform2D>();
+		}
+
+		auto& world_transforms = registry.pool<WorldTransform2D>();
+		const Transform2D* in = transforms.data();
+		WorldTransform2D* out = world_transforms.data();
+
+		// the offset is a copy either way, only rotation and scale cost sin/cos and a matrix
+		m_dirty.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			bool moved = out[i].offset != in[i].translation;
+			out[i].offset = in[i].translation;
+			if (in[i].rotation != out[i].rotation || in[i].scale != out[i].scale)
+			{
+				out[i].rotation = in[i].rotation;
+				out[i].scale = in[i].scale;
+				m_dirty.push_back(static_cast<uint32_t>(i));
+				world_transforms.mark_changed(i);
+			}
+			else if (moved)
+			{
+				world_transforms.mark_changed(i);
+			}
+		}
+
+	#ifdef JVSC_X64
+		if (m_simd_level == SimdLevel::AVX2)
+			build_matrices_avx2(in, out, m_dirty.data(), m_dirty.size());
+		else if (m_simd_level == SimdLevel::SSE2)
+			build_matrices_sse2(in, out, m_dirty.data(), m_dirty.size());
+		else
+	#endif
+			build_matrices_scalar(in, out, m_dirty.data(), m_dirty.size());
+	}
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// lib
+#include "jvsc_components.hpp"
+#include "jvsc_registry.hpp"
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace jvsc {
+
+	// Builds WorldTransform2D for every entity with a Transform2D, adding the component where it
+	// is missing. Only objects whose rotation or scale changed since their matrix was last built
+	// get new sin/cos and matrix, and those are done 8 (AVX2) or 4 (SSE2) at a time. Every
+	// WorldTransform2D that changed goes on its pool's change list when the pool tracks changes.
+	class TransformSystem
+	{
+	public:
+
+		enum class SimdLevel
+		{
+			Scalar,
+			SSE2,
+			AVX2
+		};
+
+		TransformSystem();
+		~TransformSystem() = default;
+
+		void update(JvscRegistry& registry);
+
+		// clamped to what the CPU supports, mostly for comparing the paths
+		void set_simd_level(SimdLevel level) { m_simd_level = level < s_supported_level ? level : s_supported_level; }
+		SimdLevel simd_level() const { return m_simd_level; }
+
+		// objects whose matrix was rebuilt by the last update
+		size_t rebuilt_count() const { return m_dirty.size(); }
+
+		static SimdLevel supported_simd_level() { return s_supported_level; }
+
+	private:
+
+		static SimdLevel detect_simd_level();
+
+		static const SimdLevel s_supported_level;
+
+		SimdLevel m_simd_level;
+
+		// indices into the packed Transform2D / WorldTransform2D arrays, reused across frames
+		std::vector<uint32_t> m_dirty;
+	};
+
+}
@@ -1,2 +1,6 @@
 C:/VulkanSDK/1.3.296.0/Bin/glslc.exe JvscEngine/src/shaders/simple_shader.vert -o out/build/x64-Debug/JvscEngine/simple_shader.vert.spv
-C:/VulkanSDK/1.3.296.0/Bin/glslc.exe JvscEngine/src/shaders/simple_shader.frag -o out/build/x64-Debug/JvscEngine/simple_shader.frag.spv
\ No newline at end of file
+C:/VulkanSDK/1.3.296.0/Bin/glslc.exe JvscEngine/src/shaders/simple_shader.frag -o out/build/x64-Debug/JvscEngine/simple_shader.frag.spv
+C:/VulkanSDK/1.3.296.0/Bin/glslc.exe JvscEngine/src/shaders/simple_shader_instanced.vert -o out/build/x64-Debug/JvscEngine/simple_shader_instanced.vert.spv
+C:/VulkanSDK/1.3.296.0/Bin/glslc.exe JvscEngine/src/shaders/simple_shader_instanced.frag -o out/build/x64-Debug/JvscEngine/simple_shader_instanced.frag.spv
+C:/VulkanSDK/1.3.296.0/Bin/glslc.exe JvscEngine/src/shaders/indirect_shader.vert -o out/build/x64-Debug/JvscEngine/indirect_shader.vert.spv
+C:/VulkanSDK/1.3.296.0/Bin/glslc.exe JvscEngine/src/shaders/cull.comp -o out/build/x64-Debug/JvscEngine/cull.comp.spv
\ No newline at end of file